@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/Simd.hpp"
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace LinerAlgebra
+{
+    namespace bench
+    {
+#pragma region "Allocation counters"
+        /// @brief Calls into the global operator new, counted by the replacement operators in bench/main.cpp
+        struct AllocationCounter
+        {
+            static std::atomic<size_t> &Count()
+            {
+                static std::atomic<size_t> count{0};
+                return count;
+            }
+            static std::atomic<size_t> &Bytes()
+            {
+                static std::atomic<size_t> bytes{0};
+                return bytes;
+            }
+            static void Add(size_t bytes)
+            {
+                Count().fetch_add(1, std::memory_order_relaxed);
+                Bytes().fetch_add(bytes, std::memory_order_relaxed);
+            }
+        };
+#pragma endregion
+
+        /// @brief Keep value alive and opaque to the optimizer
+        template <typename _Ty>
+        inline void DoNotOptimize(const _Ty &value)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            static const void *volatile sink;
+            sink = &value;
+            _ReadWriteBarrier();
+#else
+            asm volatile("" : : "r,m"(value) : "memory");
+#endif
+        }
+
+        struct Result
+        {
+            std::string name;
+            size_t iterations;
+            double nsPerOp;
+            double gflops;      // 0 when the benchmark declares no flops
+            double bytesPerOp;  // heap bytes requested per operation
+            double allocsPerOp; // heap allocations per operation
+        };
+
+        /// @brief Times each benchmark by doubling the iteration count until a run lasts at least MinTime
+        class Runner
+        {
+            std::vector<Result> results;
+            std::string filter;
+            std::chrono::duration<double> minTime;
+
+        public:
+            explicit Runner(std::string filter = "", double minSeconds = 0.2) : filter(std::move(filter)), minTime(minSeconds) {}
+
+            /// @param name Unique name, "group/case/size"
+            /// @param flops Floating point operations of one call, 0 when not meaningful
+            /// @param body One operation, its result should go through DoNotOptimize
+            template <typename _Func>
+            void Run(const std::string &name, double flops, _Func &&body)
+            {
+                if (!filter.empty() && name.find(filter) == std::string::npos)
+                    return;
+                body();
+                for (size_t iterations = 1;; iterations *= 2)
+                {
+                    const size_t count = AllocationCounter::Count().load(std::memory_order_relaxed);
+                    const size_t bytes = AllocationCounter::Bytes().load(std::memory_order_relaxed);
+                    const auto start = std::chrono::steady_clock::now();
+                    for (size_t i = 0; i < iterations; ++i)
+                        body();
+                    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    if (elapsed < minTime && iterations < (size_t(1) << 40))
+                        continue;
+                    const double ns = elapsed.count() * 1e9 / double(iterations);
+                    results.push_back({name, iterations, ns, flops / ns,
+                                       double(AllocationCounter::Bytes().load(std::memory_order_relaxed) - bytes) / double(iterations),
+                                       double(AllocationCounter::Count().load(std::memory_order_relaxed) - count) / double(iterations)});
+                    return;
+                }
+            }
+
+            const std::vector<Result> &Results() const noexcept { return results; }
+
+            /// @brief {"context": {...}, "benchmarks": [{...}, ...]}
+            void WriteJson(std::ostream &os) const
+            {
+#if defined(LINERALGEBRA_SIMD_AVX)
+                const char *simd = "avx";
+#elif defined(LINERALGEBRA_SIMD_SSE2)
+                const char *simd = "sse2";
+#else
+                const char *simd = "scalar";
+#endif
+                os << "{\n  \"context\": {\"simd\": \"" << simd << "\", \"hardware_threads\": "
+                   << std::thread::hardware_concurrency() << "},\n  \"benchmarks\": [";
+                for (size_t i = 0; i < results.size(); ++i)
+                {
+                    const Result &r = results[i];
+                    os << (i == 0 ? "\n" : ",\n")
+                       << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                       << ", \"ns_per_op\": " << r.nsPerOp << ", \"gflops\": " << r.gflops
+                       << ", \"bytes_per_op\": " << r.bytesPerOp << ", \"allocs_per_op\": " << r.allocsPerOp << "}";
+                }
+                os << "\n  ]\n}\n";
+            }
+        };
+    }
+}
@@ -0,0 +1,692 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "Bench.hpp"
+#include "../include/Matrix.hpp"
+#include "../include/Decomposition.hpp"
+#include "../include/SymMatrix.hpp"
+#include "../include/SparseMatrix.hpp"
+#include "../include/MatrixBatch.hpp"
+#include "../include/Rotation.hpp"
+#include "../include/MatrixExp.hpp"
+
+using namespace LinerAlgebra;
+using bench::DoNotOptimize;
+using bench::Runner;
+
+#pragma region "Counting global allocation"
+void *operator new(size_t bytes)
+{
+    bench::AllocationCounter::Add(bytes);
+    if (void *ptr = std::malloc(bytes ? bytes : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+void *operator new(size_t bytes, std::align_val_t align)
+{
+    bench::AllocationCounter::Add(bytes);
+    const size_t alignment = static_cast<size_t>(align);
+#if defined(_MSC_VER)
+    if (void *ptr = _aligned_malloc(bytes ? bytes : 1, alignment))
+#else
+    if (void *ptr = std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment))
+#endif
+        return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+#if defined(_MSC_VER)
+void operator delete(void *ptr, std::align_val_t) noexcept { _aligned_free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { _aligned_free(ptr); }
+#else
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+#endif
+#pragma endregion
+
+namespace
+{
+    template <typename _Mat>
+    void Fill(_Mat &mat, unsigned seed)
+    {
+        std::mt19937 mt(seed);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        for (size_t i = 0; i < mat.Row(); ++i)
+            for (size_t j = 0; j < mat.Col(); ++j)
+                mat(i, j) = dist(mt);
+    }
+
+    /// @brief Well conditioned symmetric positive definite A * Aᵀ + n * I
+    template <typename _Mat>
+    _Mat Spd(size_t n)
+    {
+        _Mat a(n, n);
+        Fill(a, 7);
+        _Mat res = a * a.Transpose();
+        for (size_t i = 0; i < n; ++i)
+            res(i, i) += double(n);
+        return res;
+    }
+
+    std::string Name(const std::string &group, const std::string &kind, size_t n)
+    {
+        return group + "/" + kind + "/" + std::to_string(n);
+    }
+
+#pragma region "Lazy expressions"
+    /// @brief c = a + 2b - a / 3 through BinaryOperator against the same loop written by hand
+    void Expressions(Runner &runner, size_t n)
+    {
+        DMatrix<> a(n, n), b(n, n), c(n, n);
+        Fill(a, 1);
+        Fill(b, 2);
+        const double flops = 4.0 * n * n;
+        runner.Run(Name("chain", "lazy", n), flops, [&]
+                   {
+            c = a + b * 2.0 - a / 3.0;
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("chain", "loop", n), flops, [&]
+                   {
+            const double *pa = a.Data(), *pb = b.Data();
+            double *pc = c.Data();
+            for (size_t i = 0; i < n * n; ++i)
+                pc[i] = pa[i] + pb[i] * 2.0 - pa[i] / 3.0;
+            DoNotOptimize(pc); });
+        runner.Run(Name("chain", "temporary", n), flops, [&]
+                   {
+            DMatrix<> res = a + b * 2.0 - a / 3.0;
+            DoNotOptimize(res.Data()); });
+        runner.Run(Name("squared-norm", "fused", n), 3.0 * n * n, [&]
+                   {
+            double norm = (a - b).SquaredNorm();
+            DoNotOptimize(norm); });
+        runner.Run(Name("squared-norm", "temporary", n), 3.0 * n * n, [&]
+                   {
+            c = a - b;
+            double norm = c.SquaredNorm();
+            DoNotOptimize(norm); });
+    }
+#pragma endregion
+
+#pragma region "Fixed against dynamic"
+    /// @brief The same work on Matrix<N, N> and DMatrix, N * N straddles the isLittle threshold of 280
+    template <size_t _N>
+    void FixedDynamic(Runner &runner)
+    {
+        Matrix<_N, _N> fa, fb, fc;
+        DMatrix<> da(_N, _N), db(_N, _N), dc(_N, _N);
+        Fill(fa, 1);
+        Fill(fb, 2);
+        Fill(da, 1);
+        Fill(db, 2);
+        const std::string kind = isLittle(_N, _N) ? "fixed-stack" : "fixed-heap";
+
+        runner.Run(Name("add", kind, _N), 2.0 * _N * _N, [&]
+                   {
+            fc = fa + fb * 2.0;
+            DoNotOptimize(fc); });
+        runner.Run(Name("add", "dynamic", _N), 2.0 * _N * _N, [&]
+                   {
+            dc = da + db * 2.0;
+            DoNotOptimize(dc.Data()); });
+
+        runner.Run(Name("product", kind, _N), 2.0 * _N * _N * _N, [&]
+                   {
+            fc = fa * fb;
+            DoNotOptimize(fc); });
+        runner.Run(Name("product", "dynamic", _N), 2.0 * _N * _N * _N, [&]
+                   {
+            dc.NoAlias() = da * db;
+            DoNotOptimize(dc.Data()); });
+
+        runner.Run(Name("construct", kind, _N), 0, [&]
+                   {
+            Matrix<_N, _N> m;
+            DoNotOptimize(m); });
+        runner.Run(Name("construct", "dynamic", _N), 0, [&]
+                   {
+            DMatrix<> m(_N, _N);
+            DoNotOptimize(m.Data()); });
+        runner.Run(Name("identity", kind, _N), 0, [&]
+                   {
+            auto m = Matrix<_N, _N>::Identity();
+            DoNotOptimize(m); });
+        runner.Run(Name("identity", "dynamic", _N), 0, [&]
+                   {
+            auto m = DMatrix<>::Identity(_N);
+            DoNotOptimize(m.Data()); });
+        runner.Run(Name("random", kind, _N), 0, [&]
+                   {
+            auto m = Matrix<_N, _N>::Random();
+            DoNotOptimize(m); });
+        runner.Run(Name("random", "dynamic", _N), 0, [&]
+                   {
+            auto m = DMatrix<>::Random(_N, _N);
+            DoNotOptimize(m.Data()); });
+    }
+#pragma endregion
+
+#pragma region "Products"
+    void Products(Runner &runner, size_t n)
+    {
+        DMatrix<> a(n, n), b(n, n), c(n, n);
+        Fill(a, 1);
+        Fill(b, 2);
+        runner.Run(Name("gemm", "dynamic", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = a * b;
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("gemm", "accumulate", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() += a * b;
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("gemm", "transposed", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = a * b.Transpose();
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("transpose", "copy", n), 0, [&]
+                   {
+            c.NoAlias() = a.Transpose();
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("transpose", "in-place", n), 0, [&]
+                   {
+            a.TransposeInPlace();
+            DoNotOptimize(a.Data()); });
+        // the operands of a + b are summed once into a cache instead of read a row apart for every element
+        runner.Run(Name("transpose", "expression", n), 2.0 * n * n, [&]
+                   {
+            c.NoAlias() = (a + b).Transpose() + b;
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("gemm", "expression-operands", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = (a + b) * (a - b);
+            DoNotOptimize(c.Data()); });
+    }
+#pragma endregion
+
+#pragma region "Precision"
+    /// @brief float against double kernels, the accumulation options of float products and sums,
+    /// and a solve refined from float factors against the double LU
+    void Precision(Runner &runner, size_t n)
+    {
+        DMatrix<float> a(n, n), b(n, n), c(n, n);
+        DMatrix<> ad(n, n), bd(n, n), cd(n, n);
+        Fill(a, 1);
+        Fill(b, 2);
+        Fill(ad, 1);
+        Fill(bd, 2);
+        runner.Run(Name("gemm", "float", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = a * b;
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("gemm", "float-double-sum", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = Product<Accumulation::Double>(a, b);
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("gemm", "float-kahan", n), 2.0 * n * n * n, [&]
+                   {
+            c.NoAlias() = Product<Accumulation::Kahan>(a, b);
+            DoNotOptimize(c.Data()); });
+        runner.Run(Name("sum", "double", n * n), n * n, [&]
+                   {
+            double sum = ad.Sum();
+            DoNotOptimize(sum); });
+        runner.Run(Name("sum", "float", n * n), n * n, [&]
+                   {
+            float sum = a.Sum();
+            DoNotOptimize(sum); });
+        runner.Run(Name("sum", "float-double-sum", n * n), n * n, [&]
+                   {
+            double sum = a.Sum<Accumulation::Double>();
+            DoNotOptimize(sum); });
+        runner.Run(Name("sum", "float-kahan", n * n), n * n, [&]
+                   {
+            float sum = a.Sum<Accumulation::Kahan>();
+            DoNotOptimize(sum); });
+        // the float operand is widened a packet at a time
+        runner.Run(Name("axpy", "mixed", n * n), 2.0 * n * n, [&]
+                   {
+            cd.NoAlias() = ad + a * 2.0f;
+            DoNotOptimize(cd.Data()); });
+        for (size_t i = 0; i < n; ++i)
+            ad(i, i) += double(n);
+        DMatrix<> rhs(n, 1), x(n, 1);
+        Fill(rhs, 3);
+        runner.Run(Name("solve", "lu-double", n), 2.0 / 3.0 * n * n * n, [&]
+                   {
+            LU<DMatrix<>> lu(ad);
+            x = lu.Solve(rhs);
+            DoNotOptimize(x.Data()); });
+        runner.Run(Name("solve", "refined-float", n), 2.0 / 3.0 * n * n * n, [&]
+                   {
+            RefinedLU<DMatrix<>> lu(ad);
+            x = lu.Solve(rhs);
+            DoNotOptimize(x.Data()); });
+    }
+#pragma endregion
+#pragma region "Factorizations"
+    template <typename _Mat>
+    void Factorizations(Runner &runner, size_t n, const std::string &kind)
+    {
+        using Vector = std::conditional_t<_Mat::IsDynamic(), DMatrix<>, Matrix<_Mat::RowsAtCompileTime, 1>>;
+        const _Mat spd = Spd<_Mat>(n);
+        Vector rhs(n, 1);
+        Fill(rhs, 3);
+        const double cube = double(n) * n * n;
+        Cholesky<_Mat> cholesky(spd);
+        runner.Run(Name("cholesky", kind, n), cube / 3.0, [&]
+                   {
+            cholesky.Compute(spd);
+            DoNotOptimize(cholesky); });
+        LDLT<_Mat> ldlt;
+        runner.Run(Name("ldlt", kind, n), cube / 3.0, [&]
+                   {
+            ldlt.Compute(spd);
+            DoNotOptimize(ldlt); });
+        LU<_Mat> lu;
+        runner.Run(Name("lu", kind, n), 2.0 * cube / 3.0, [&]
+                   {
+            lu.Compute(spd);
+            DoNotOptimize(lu); });
+        QR<_Mat> qr(spd);
+        runner.Run(Name("qr", kind, n), 4.0 * cube / 3.0, [&]
+                   {
+            qr.Compute(spd);
+            DoNotOptimize(qr); });
+        runner.Run(Name("cholesky-solve", kind, n), 2.0 * n * n, [&]
+                   {
+            auto x = cholesky.Solve(rhs);
+            DoNotOptimize(x); });
+        runner.Run(Name("qr-solve", kind, n), 3.0 * n * n, [&]
+                   {
+            auto x = qr.Solve(rhs);
+            DoNotOptimize(x); });
+    }
+
+    /// @brief _Chunk observations of _N unknowns per epoch: solved alone, folded into the triangle of every
+    /// earlier epoch, or refactored together with all the rows of `epochs` epochs
+    template <size_t _N, size_t _Chunk>
+    void LeastSquares(Runner &runner, size_t epochs)
+    {
+        Matrix<_Chunk, _N> a;
+        Matrix<_Chunk, 1> b;
+        Fill(a, 4);
+        Fill(b, 5);
+        const double epoch = 2.0 * _Chunk * _N * _N;
+        runner.Run(Name("lsq", "epoch-qr", _Chunk), epoch, [&]
+                   {
+            auto x = QR(a).Solve(b);
+            DoNotOptimize(x); });
+        IncrementalQR<Matrix<_N, _N>> incremental;
+        runner.Run(Name("lsq", "incremental", _Chunk), epoch, [&]
+                   {
+            incremental.Add(a, b);
+            auto x = incremental.Solve();
+            DoNotOptimize(x); });
+        const size_t rows = epochs * _Chunk;
+        DMatrix<> history(rows, _N), rhs(rows, 1);
+        Fill(history, 4);
+        Fill(rhs, 5);
+        QR<DMatrix<>> batch;
+        runner.Run(Name("lsq", "refactor", rows), epoch * epochs, [&]
+                   {
+            batch.Compute(history);
+            auto x = batch.Solve(rhs);
+            DoNotOptimize(x); });
+    }
+
+    template <size_t _N>
+    void Covariance(Runner &runner, size_t n)
+    {
+        Matrix<_N, _N> f(n, n);
+        Fill(f, 1);
+        const Matrix<_N, _N> pd = Spd<Matrix<_N, _N>>(n);
+        const SymMatrix<_N> q(pd);
+        SymMatrix<_N> p(pd);
+        const double cube = double(n) * n * n;
+        runner.Run(Name("propagate", "sym", n), 3.0 * cube, [&]
+                   {
+            p = q;
+            p.Propagate(f, q);
+            DoNotOptimize(p); });
+        Matrix<_N, _N> dense = pd;
+        runner.Run(Name("propagate", "dense", n), 4.0 * cube, [&]
+                   {
+            Matrix<_N, _N> fp = f * pd;
+            dense.NoAlias() = fp * f.Transpose();
+            dense += pd;
+            DoNotOptimize(dense); });
+    }
+
+    /// @brief Innovation covariance H * P * Hᵀ + R of one epoch, every matrix built inside the epoch
+    /// like a filter with a varying number of measurements does
+    template <typename _Mat>
+    void Innovation(Runner &runner, size_t rows, const std::string &kind)
+    {
+        constexpr size_t states = 8;
+        const DMatrix<> p = Spd<DMatrix<>>(states);
+        DMatrix<> source(rows, states);
+        Fill(source, 5);
+        runner.Run(Name("innovation", kind, rows), 4.0 * rows * states * (states + rows), [&]
+                   {
+            _Mat h = source;
+            _Mat hp = h * p;
+            _Mat s(rows, rows);
+            s.NoAlias() = hp * h.Transpose();
+            s.Diagonal() += 0.25;
+            DoNotOptimize(s); });
+    }
+
+    void Sparse(Runner &runner, size_t rows, size_t cols, size_t perRow)
+    {
+        std::mt19937 mt(5);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        std::vector<Triplet<double>> triplets;
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t k = 0; k < perRow; ++k)
+                triplets.push_back({i, mt() % cols, dist(mt)});
+        const auto a = CsrMatrix<>::FromTriplets(rows, cols, triplets);
+        DMatrix<> b(rows, 1);
+        Fill(b, 4);
+        runner.Run(Name("sparse", "assemble", rows), 0, [&]
+                   {
+            auto m = CsrMatrix<>::FromTriplets(rows, cols, triplets);
+            DoNotOptimize(m); });
+        runner.Run(Name("sparse", "AtA", rows), 2.0 * rows * perRow * perRow / 2.0, [&]
+                   {
+            auto n = AtA(a);
+            DoNotOptimize(n); });
+        runner.Run(Name("sparse", "Atb", rows), 2.0 * a.NonZeros(), [&]
+                   {
+            DMatrix<> v = Atb(a, b);
+            DoNotOptimize(v.Data()); });
+    }
+
+    /// @brief _N independent _M x _M SPD solves, batched across SIMD lanes against one Cholesky<Matrix> at a time
+    template <size_t _M, size_t _N>
+    void Batch(Runner &runner)
+    {
+        std::vector<Matrix<_M, _M>> spd(_N);
+        std::vector<Matrix<_M, 1>> rhs(_N);
+        MatrixBatch<_M, _M, _N> a;
+        MatrixBatch<_M, 1, _N> b;
+        for (size_t k = 0; k < _N; ++k)
+        {
+            spd[k] = Spd<Matrix<_M, _M>>(_M);
+            Fill(rhs[k], unsigned(k));
+            a.Set(k, spd[k]);
+            b.Set(k, rhs[k]);
+        }
+        const double flops = _N * (double(_M) * _M * _M / 3.0 + 2.0 * _M * _M);
+        runner.Run(Name("batch-solve", "soa", _M), flops, [&]
+                   {
+            Cholesky<MatrixBatch<_M, _M, _N>> cholesky(a);
+            auto x = cholesky.Solve(b);
+            DoNotOptimize(x); });
+        runner.Run(Name("batch-solve", "loop", _M), flops, [&]
+                   {
+            for (size_t k = 0; k < _N; ++k)
+            {
+                Cholesky<Matrix<_M, _M>> cholesky(spd[k]);
+                auto x = cholesky.Solve(rhs[k]);
+                DoNotOptimize(x);
+            } });
+        MatrixBatch<_M, _M, _N> c;
+        runner.Run(Name("batch-product", "soa", _M), 2.0 * _N * _M * _M * _M, [&]
+                   {
+            c = a * a;
+            DoNotOptimize(c); });
+    }
+#pragma endregion
+
+#pragma region "Attitude"
+    /// @brief One strapdown attitude update per gyro sample, C = C * exp(ω dt), and rotating vectors to the nav frame,
+    /// through Matrix<3, 3> expressions against the dedicated rotation types
+    void Attitude(Runner &runner, size_t samples)
+    {
+        std::vector<RotationVector<>> increments(samples);
+        std::vector<double> vectors(3 * samples), rotated(3 * samples);
+        Matrix<3, 1> rate;
+        for (size_t k = 0; k < samples; ++k)
+        {
+            Fill(rate, unsigned(k));
+            increments[k] = RotationVector<>(rate * 0.005);
+        }
+        Fill(rate, 11);
+        for (size_t k = 0; k < samples; ++k)
+            vectors[3 * k + k % 3] = 1.0;
+        Matrix<3, 3> dense = Matrix<3, 3>::Identity();
+        runner.Run(Name("attitude-update", "matrix", samples), 0, [&]
+                   {
+            for (const RotationVector<> &increment : increments)
+            {
+                // Rodrigues' formula written with Matrix<3, 3> expressions
+                const double x = increment[0], y = increment[1], z = increment[2];
+                const Matrix<3, 3> skew{{0, -z, y}, {z, 0, -x}, {-y, x, 0}};
+                const double angle = increment.Angle();
+                const Matrix<3, 3> skew2 = skew * skew;
+                const Matrix<3, 3> step = Matrix<3, 3>::Identity() + skew * (std::sin(angle) / angle) +
+                                          skew2 * ((1.0 - std::cos(angle)) / (angle * angle));
+                dense = dense * step;
+            }
+            DoNotOptimize(dense); });
+        RotationMatrix<> dcm;
+        runner.Run(Name("attitude-update", "dcm", samples), 0, [&]
+                   {
+            for (const RotationVector<> &increment : increments)
+                dcm *= RotationMatrix<>(increment);
+            dcm.Normalize();
+            DoNotOptimize(dcm); });
+        Quaternion<> q;
+        runner.Run(Name("attitude-update", "quaternion", samples), 0, [&]
+                   {
+            for (const RotationVector<> &increment : increments)
+                q *= Quaternion<>(increment);
+            q.Normalize();
+            DoNotOptimize(q); });
+        runner.Run(Name("rotate", "matrix", samples), 0, [&]
+                   {
+            for (size_t k = 0; k < samples; ++k)
+            {
+                Matrix<3, 1> v;
+                std::copy_n(vectors.data() + 3 * k, 3, v.Data());
+                const Matrix<3, 1> res = dense * v;
+                std::copy_n(res.Data(), 3, rotated.data() + 3 * k);
+            }
+            DoNotOptimize(rotated.data()); });
+        runner.Run(Name("rotate", "dcm", samples), 0, [&]
+                   {
+            dcm.Rotate(vectors.data(), rotated.data(), samples);
+            DoNotOptimize(rotated.data()); });
+        // the same vectors as a structure of arrays, component i of vector k at i * 1024 + k
+        MatrixBatch<3, 1, 1024> batch, res;
+        for (size_t k = 0; k < std::min<size_t>(samples, 1024); ++k)
+            for (size_t i = 0; i < 3; ++i)
+                batch.Data()[i * 1024 + k] = vectors[3 * k + i];
+        runner.Run(Name("rotate", "dcm-soa", 1024), 0, [&]
+                   {
+            dcm.Rotate(batch, res);
+            DoNotOptimize(res); });
+    }
+#pragma endregion
+
+#pragma region "Exponential"
+    /// @brief Transition and process noise for a continuous-time model, against the truncated series
+    /// users tend to write by hand with Matrix expressions
+    template <size_t _N>
+    void Exponential(Runner &runner)
+    {
+        Matrix<_N, _N> f, q = Matrix<_N, _N>::Identity() * 0.01;
+        Fill(f, 3);
+        Matrix<_N, _N> g = Matrix<_N, _N>::Identity();
+        const double dt = 0.01;
+        const double flops = 2.0 * _N * _N * _N;
+        runner.Run(Name("expm", "series-expr", _N), 3 * flops, [&]
+                   {
+            const Matrix<_N, _N> a = f * dt;
+            const Matrix<_N, _N> a2 = a * a;
+            const Matrix<_N, _N> phi = Matrix<_N, _N>::Identity() + a + a2 * 0.5 + a2 * a * (1.0 / 6.0);
+            DoNotOptimize(phi); });
+        runner.Run(Name("expm", "taylor3", _N), 2 * flops, [&]
+                   {
+            const Matrix<_N, _N> phi = ExpTaylor(f * dt, 3);
+            DoNotOptimize(phi); });
+        runner.Run(Name("expm", "pade", _N), 0, [&]
+                   {
+            const Matrix<_N, _N> phi = Exp(f * dt);
+            DoNotOptimize(phi); });
+        runner.Run(Name("discretize", "van-loan", _N), 0, [&]
+                   {
+            auto model = Discretize(f, g, q, dt);
+            DoNotOptimize(model.qd); });
+        runner.Run(Name("discretize", "taylor3", _N), 0, [&]
+                   {
+            auto model = Discretize(f, g, q, dt, 3);
+            DoNotOptimize(model.qd); });
+    }
+#pragma endregion
+#pragma region "Text"
+    /// @brief Written text reads back bit for bit, and malformed fields are rejected instead of shifting columns
+    void CheckText(const DMatrix<> &a)
+    {
+        const auto same = [](const DMatrix<> &x, const DMatrix<> &y)
+        { return x.Row() == y.Row() && x.Col() == y.Col() && std::equal(x.Data(), x.Data() + x.Row() * x.Col(), y.Data()); };
+        const auto rejected = [](std::string_view text)
+        {
+            try
+            {
+                io::Parse(text);
+            }
+            catch (const ParseExcept &)
+            {
+                return true;
+            }
+            return false;
+        };
+        for (const auto layout : {io::TextLayout::Whitespace, io::TextLayout::Csv, io::TextLayout::Aligned})
+            if (!same(io::Parse(io::Format(a, {layout})), a))
+                throw std::runtime_error("text round trip changed the matrix");
+        DMatrix<> expected(2, 2);
+        expected(0, 0) = 1, expected(0, 1) = 0.5, expected(1, 0) = -3, expected(1, 1) = 4;
+        if (!same(io::Parse("+1 , +.5\n-3\t4\n"), expected) || !same(io::Parse("1,0.5\r\n-3,4\r\n"), expected))
+            throw std::runtime_error("text parse of signed or padded fields failed");
+        for (const std::string_view bad : {"1,,2\n3,4\n", "1,2,\n3,4\n", ",1,2\n3,4\n", "+-1\n", "1 2x\n"})
+            if (!rejected(bad))
+                throw std::runtime_error("malformed text was parsed");
+    }
+
+    /// @brief to_chars into a reused string against an ostringstream written one element at a time, and parsing back
+    void Text(Runner &runner, size_t n)
+    {
+        DMatrix<> a(n, n);
+        Fill(a, 13);
+        CheckText(a);
+        const io::TextSpec spec{io::TextLayout::Whitespace, 12, 4, 'f'};
+        std::string text;
+        runner.Run(Name("text-format", "to_chars", n), 0, [&]
+                   {
+            text.clear();
+            io::FormatTo(text, a, spec);
+            DoNotOptimize(text); });
+        runner.Run(Name("text-format", "ostream", n), 0, [&]
+                   {
+            std::ostringstream os;
+            os.setf(std::ios::fixed);
+            os.precision(4);
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    os.width(12);
+                    os << a(i, j) << ' ';
+                }
+                os << '\n';
+            }
+            DoNotOptimize(os); });
+        text = io::Format(a);
+        DMatrix<> b(n, n);
+        runner.Run(Name("text-parse", "from_chars", n), 0, [&]
+                   {
+            std::string_view view = text;
+            io::ParseNext(view, b);
+            DoNotOptimize(b); });
+        runner.Run(Name("text-parse", "istream", n), 0, [&]
+                   {
+            std::istringstream is(text);
+            for (size_t i = 0; i < n * n; ++i)
+                is >> b.Data()[i];
+            DoNotOptimize(b); });
+    }
+#pragma endregion
+}
+
+/// Usage: LinerAlgebraBench [--filter=substring] [--min-time=seconds] [--out=file.json]
+int main(int argc, char **argv)
+{
+    std::string filter, out;
+    double minTime = 0.2;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0)
+            filter = arg.substr(9);
+        else if (arg.rfind("--min-time=", 0) == 0)
+            minTime = std::stod(arg.substr(11));
+        else if (arg.rfind("--out=", 0) == 0)
+            out = arg.substr(6);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--filter=substring] [--min-time=seconds] [--out=file.json]\n";
+            return 1;
+        }
+    }
+
+    Runner runner(filter, minTime);
+    for (size_t n : {64, 256, 1024})
+        Expressions(runner, n);
+    // 8 x 8 and 16 x 16 live on the stack, 17 x 17 and 24 x 24 are fixed but on the heap
+    FixedDynamic<4>(runner);
+    FixedDynamic<8>(runner);
+    FixedDynamic<16>(runner);
+    FixedDynamic<17>(runner);
+    FixedDynamic<24>(runner);
+    for (size_t n : {64, 256, 512})
+        Products(runner, n);
+    for (size_t n : {256, 512})
+        Precision(runner, n);
+    Factorizations<Matrix<6, 6>>(runner, 6, "fixed");
+    Factorizations<Matrix<15, 15>>(runner, 15, "fixed");
+    for (size_t n : {64, 256, 512})
+        Factorizations<DMatrix<>>(runner, n, "dynamic");
+    LeastSquares<8, 40>(runner, 100);
+    Covariance<15>(runner, 15);
+    Covariance<Dynamic>(runner, 150);
+    for (size_t rows : {4, 12, 24})
+    {
+        Innovation<SmallDMatrix<24 * 24>>(runner, rows, "small");
+        Innovation<DMatrix<>>(runner, rows, "dynamic");
+    }
+    Sparse(runner, 100000, 200, 8);
+    Batch<3, 1024>(runner);
+    Batch<6, 1024>(runner);
+    Attitude(runner, 1024);
+    Exponential<15>(runner);
+    Exponential<21>(runner);
+    for (size_t n : {16, 256})
+        Text(runner, n);
+
+    if (out.empty())
+        runner.WriteJson(std::cout);
+    else
+    {
+        std::ofstream file(out);
+        runner.WriteJson(file);
+    }
+    return 0;
+}
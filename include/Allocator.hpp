@@ -0,0 +1,455 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LinerAlgebra
+{
+    namespace memory
+    {
+        /// @brief Alignment of every block handed out by the allocators below, one cache line / AVX-512 register
+        constexpr size_t Alignment = 64;
+
+#pragma region "Counters"
+        /// @brief Snapshot of the blocks the library asks for itself: AlignedAllocator storage, arena chunks and
+        /// every scratch buffer or cache used while evaluating. Storage of a matrix or decomposition comes from the
+        /// allocator of that matrix, with std::allocator it is not seen here, instrument::Stats counts it.
+        struct Stats
+        {
+            size_t heapAllocations; // blocks taken from the global heap
+            size_t heapBytes;
+            size_t arenaAllocations; // blocks served from an arena without touching the heap
+            size_t arenaBytes;
+        };
+
+        namespace detail
+        {
+            struct Counters
+            {
+                std::atomic<size_t> heapAllocations{0};
+                std::atomic<size_t> heapBytes{0};
+                std::atomic<size_t> arenaAllocations{0};
+                std::atomic<size_t> arenaBytes{0};
+            };
+            inline Counters &GlobalCounters()
+            {
+                static Counters counters;
+                return counters;
+            }
+
+            inline void *SystemAllocate(size_t bytes)
+            {
+                Counters &counters = GlobalCounters();
+                counters.heapAllocations.fetch_add(1, std::memory_order_relaxed);
+                counters.heapBytes.fetch_add(bytes, std::memory_order_relaxed);
+                return ::operator new(bytes, std::align_val_t(Alignment));
+            }
+            inline void SystemDeallocate(void *ptr) noexcept
+            {
+                ::operator delete(ptr, std::align_val_t(Alignment));
+            }
+        }
+
+        /// @brief Blocks counted in Stats since start or the last ResetStats()
+        inline Stats GetStats()
+        {
+            detail::Counters &counters = detail::GlobalCounters();
+            return {counters.heapAllocations.load(std::memory_order_relaxed),
+                    counters.heapBytes.load(std::memory_order_relaxed),
+                    counters.arenaAllocations.load(std::memory_order_relaxed),
+                    counters.arenaBytes.load(std::memory_order_relaxed)};
+        }
+        inline void ResetStats()
+        {
+            detail::Counters &counters = detail::GlobalCounters();
+            counters.heapAllocations.store(0, std::memory_order_relaxed);
+            counters.heapBytes.store(0, std::memory_order_relaxed);
+            counters.arenaAllocations.store(0, std::memory_order_relaxed);
+            counters.arenaBytes.store(0, std::memory_order_relaxed);
+        }
+#pragma endregion
+
+        class ArenaBlock;
+
+        /// @brief Bump allocator over 64-byte aligned chunks, one per thread, rewound once per epoch
+        class Arena
+        {
+            friend class ArenaBlock;
+            struct Chunk
+            {
+                std::byte *data;
+                size_t size;
+            };
+            std::vector<Chunk> chunks;
+            size_t current = 0; // chunk being bumped
+            size_t offset = 0;  // first free byte in the current chunk
+            size_t used = 0;    // bytes handed out since the last Reset
+            ArenaBlock *held = nullptr; // last block taken through an ArenaBlock and still held
+
+            void Grow(size_t bytes)
+            {
+                for (++current; current < chunks.size(); ++current)
+                {
+                    if (chunks[current].size >= bytes)
+                    {
+                        offset = 0;
+                        return;
+                    }
+                }
+                const size_t size = std::max(bytes, chunks.empty() ? InitialSize : chunks.back().size * 2);
+                chunks.push_back({static_cast<std::byte *>(detail::SystemAllocate(size)), size});
+                current = chunks.size() - 1;
+                offset = 0;
+            }
+            /// @brief Empty every ArenaBlock taken at or after logical offset from
+            void DropHeld(size_t from) noexcept;
+
+        public:
+            static constexpr size_t InitialSize = size_t(1) << 20;
+
+            Arena() = default;
+            Arena(const Arena &) = delete;
+            Arena &operator=(const Arena &) = delete;
+            ~Arena()
+            {
+                DropHeld(0);
+                for (auto &chunk : chunks)
+                    detail::SystemDeallocate(chunk.data);
+            }
+
+            /// @brief Arena of the calling thread
+            static Arena &Local()
+            {
+                thread_local Arena arena;
+                return arena;
+            }
+
+            void *Allocate(size_t bytes)
+            {
+                bytes = (std::max<size_t>(bytes, 1) + Alignment - 1) / Alignment * Alignment;
+                if (chunks.empty() || offset + bytes > chunks[current].size)
+                    Grow(bytes);
+                void *ptr = chunks[current].data + offset;
+                offset += bytes;
+                used += bytes;
+                detail::Counters &counters = detail::GlobalCounters();
+                counters.arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+                counters.arenaBytes.fetch_add(bytes, std::memory_order_relaxed);
+                return ptr;
+            }
+
+            /// @brief Release everything handed out since the last Reset. If the epoch needed more than
+            /// one chunk they are merged into one, so a repeating workload stops calling the system allocator.
+            void Reset()
+            {
+                DropHeld(0);
+                if (chunks.size() > 1 && used > chunks.front().size)
+                {
+                    size_t total = 0;
+                    for (auto &chunk : chunks)
+                    {
+                        total += chunk.size;
+                        detail::SystemDeallocate(chunk.data);
+                    }
+                    chunks.clear();
+                    chunks.push_back({static_cast<std::byte *>(detail::SystemAllocate(total)), total});
+                }
+                current = 0;
+                offset = 0;
+                used = 0;
+            }
+
+            /// @brief Allocation state to come back to with Rewind
+            struct Position
+            {
+                size_t current;
+                size_t offset;
+                size_t used;
+            };
+            Position Mark() const noexcept { return {current, offset, used}; }
+            /// @brief Release everything handed out since position was marked, blocks of later marks included
+            void Rewind(const Position &position) noexcept
+            {
+                DropHeld(position.used);
+                current = position.current;
+                offset = position.offset;
+                used = position.used;
+            }
+
+            size_t Used() const noexcept { return used; }
+            size_t Capacity() const noexcept
+            {
+                size_t total = 0;
+                for (auto &chunk : chunks)
+                    total += chunk.size;
+                return total;
+            }
+        };
+
+        /// @brief One block of the thread-local Arena for an object that can outlive the scope it was filled in,
+        /// such as the cache of a lazy expression. A Rewind or Reset that releases the block empties it, so the
+        /// holder sees the memory is gone instead of reading whatever was allocated there next.
+        class ArenaBlock
+        {
+            friend class Arena;
+
+            Arena *arena = nullptr;
+            void *data = nullptr;
+            Arena::Position start{}; // arena state right before the block was taken
+            size_t end = 0;          // Used() of the arena right after
+            ArenaBlock *previous = nullptr; // blocks held from the same arena, in allocation order
+
+            void Drop() noexcept
+            {
+                if (arena->held == this)
+                    arena->held = previous;
+                else
+                {
+                    // released out of order, unlink it from the block taken right after
+                    ArenaBlock *after = arena->held;
+                    while (after->previous != this)
+                        after = after->previous;
+                    after->previous = previous;
+                }
+                arena = nullptr;
+                data = nullptr;
+                previous = nullptr;
+            }
+
+        public:
+            ArenaBlock() = default;
+            ArenaBlock(const ArenaBlock &) = delete;
+            ArenaBlock &operator=(const ArenaBlock &) = delete;
+            ~ArenaBlock() { Release(); }
+
+            /// @brief bytes from the arena of the calling thread, the block held so far is released first
+            void *Acquire(size_t bytes)
+            {
+                Release();
+                Arena &local = Arena::Local();
+                start = local.Mark();
+                data = local.Allocate(bytes);
+                end = local.Used();
+                arena = &local;
+                previous = std::exchange(local.held, this);
+                return data;
+            }
+            /// @brief Give the block back. The arena reuses it at once when nothing was taken after it,
+            /// otherwise with the next Rewind or Reset below it.
+            void Release() noexcept
+            {
+                if (!data)
+                    return;
+                if (arena->held == this && arena->Used() == end)
+                    arena->Rewind(start); // drops the block as well
+                else
+                    Drop();
+            }
+            void *Data() const noexcept { return data; }
+        };
+
+        inline void Arena::DropHeld(size_t from) noexcept
+        {
+            // blocks are held in allocation order, so the ones to drop are at the end of the list
+            while (held && held->start.used >= from)
+                held->Drop();
+        }
+
+        /// @brief Rewinds the thread-local arena when the epoch ends
+        /// Every arena-backed matrix created inside the scope must be dead by then.
+        class ArenaEpoch
+        {
+        public:
+            ArenaEpoch() = default;
+            ArenaEpoch(const ArenaEpoch &) = delete;
+            ArenaEpoch &operator=(const ArenaEpoch &) = delete;
+            ~ArenaEpoch() { Arena::Local().Reset(); }
+        };
+
+        /// @brief Rewinds the thread-local arena to where it was when the scope began, so scratch buffers of one
+        /// call are reused by the next. Scopes nest, the arena behaves like a stack inside an epoch.
+        class ArenaScope
+        {
+            Arena &arena;
+            Arena::Position position;
+
+        public:
+            ArenaScope() : arena(Arena::Local()), position(arena.Mark()) {}
+            ArenaScope(const ArenaScope &) = delete;
+            ArenaScope &operator=(const ArenaScope &) = delete;
+            ~ArenaScope() { arena.Rewind(position); }
+        };
+
+        /// @brief Standard allocator returning 64-byte aligned blocks from the global heap
+        template <typename _Ty>
+        struct AlignedAllocator
+        {
+            using value_type = _Ty;
+
+            AlignedAllocator() noexcept = default;
+            template <typename _Other>
+            AlignedAllocator(const AlignedAllocator<_Other> &) noexcept {}
+
+            _Ty *allocate(size_t count) { return static_cast<_Ty *>(detail::SystemAllocate(count * sizeof(_Ty))); }
+            void deallocate(_Ty *ptr, size_t) noexcept { detail::SystemDeallocate(ptr); }
+
+            template <typename _Other>
+            bool operator==(const AlignedAllocator<_Other> &) const noexcept { return true; }
+        };
+
+        /// @brief Standard allocator serving 64-byte aligned blocks from the thread-local Arena.
+        /// deallocate is a no-op, memory comes back when the arena is Reset.
+        template <typename _Ty>
+        struct ArenaAllocator
+        {
+            using value_type = _Ty;
+
+            ArenaAllocator() noexcept = default;
+            template <typename _Other>
+            ArenaAllocator(const ArenaAllocator<_Other> &) noexcept {}
+
+            _Ty *allocate(size_t count) { return static_cast<_Ty *>(Arena::Local().Allocate(count * sizeof(_Ty))); }
+            void deallocate(_Ty *, size_t) noexcept {}
+
+            template <typename _Other>
+            bool operator==(const ArenaAllocator<_Other> &) const noexcept { return true; }
+        };
+
+#pragma region "Small buffer"
+        /// @brief Allocator policy of a dynamic matrix that keeps up to _N elements inside the matrix object
+        /// and only asks _Alloc for a block beyond that, see SmallDMatrix
+        template <typename _Ty, size_t _N, typename _Alloc = std::allocator<_Ty>>
+        struct InlineAllocator : _Alloc
+        {
+            using value_type = _Ty;
+            using HeapAllocator = _Alloc;
+            static constexpr size_t InlineCapacity = _N;
+            template <typename _Other>
+            struct rebind
+            {
+                using other = InlineAllocator<_Other, _N, typename std::allocator_traits<_Alloc>::template rebind_alloc<_Other>>;
+            };
+
+            InlineAllocator() noexcept = default;
+            template <typename _Other, typename _OAlloc>
+            InlineAllocator(const InlineAllocator<_Other, _N, _OAlloc> &other) noexcept : _Alloc(static_cast<const _OAlloc &>(other)) {}
+        };
+
+        /// @brief The subset of std::vector matrix storage needs, holding up to _N elements in place.
+        /// Larger sizes move to a block from the stateless _Alloc, which is kept like vector keeps its capacity.
+        template <typename _Ty, size_t _N, typename _Alloc>
+        class SmallVector
+        {
+            static_assert(std::is_trivially_copyable_v<_Ty>, "SmallVector holds plain numbers only");
+            using Traits = std::allocator_traits<_Alloc>;
+
+            _Ty *ptr;
+            size_t count = 0;
+            size_t reserved = _N;
+            _Ty buffer[_N];
+
+            bool IsInline() const noexcept { return ptr == buffer; }
+            void Release() noexcept
+            {
+                if (!IsInline())
+                {
+                    _Alloc alloc;
+                    Traits::deallocate(alloc, ptr, reserved);
+                }
+            }
+
+        public:
+            SmallVector() noexcept : ptr(buffer) {}
+            explicit SmallVector(size_t size) : ptr(buffer) { resize(size); }
+            SmallVector(const SmallVector &other) : ptr(buffer)
+            {
+                reserve(other.count);
+                std::copy_n(other.ptr, other.count, ptr);
+                count = other.count;
+            }
+            /// @brief A heap block is taken over, inline elements are copied
+            SmallVector(SmallVector &&other) noexcept : ptr(buffer)
+            {
+                if (other.IsInline())
+                    std::copy_n(other.ptr, other.count, ptr);
+                else
+                {
+                    ptr = std::exchange(other.ptr, other.buffer);
+                    reserved = std::exchange(other.reserved, _N);
+                }
+                count = std::exchange(other.count, 0);
+            }
+            SmallVector &operator=(const SmallVector &other)
+            {
+                if (this != &other)
+                {
+                    count = 0;
+                    reserve(other.count);
+                    std::copy_n(other.ptr, other.count, ptr);
+                    count = other.count;
+                }
+                return *this;
+            }
+            SmallVector &operator=(SmallVector &&other) noexcept
+            {
+                if (this == &other)
+                    return *this;
+                if (other.IsInline())
+                {
+                    // other fits inline, so it fits in whatever this already owns
+                    std::copy_n(other.ptr, other.count, ptr);
+                    count = std::exchange(other.count, 0);
+                }
+                else
+                {
+                    Release();
+                    ptr = std::exchange(other.ptr, other.buffer);
+                    reserved = std::exchange(other.reserved, _N);
+                    count = std::exchange(other.count, 0);
+                }
+                return *this;
+            }
+            ~SmallVector() { Release(); }
+
+            _Ty *data() noexcept { return ptr; }
+            const _Ty *data() const noexcept { return ptr; }
+            size_t size() const noexcept { return count; }
+            size_t capacity() const noexcept { return reserved; }
+            _Ty *begin() noexcept { return ptr; }
+            const _Ty *begin() const noexcept { return ptr; }
+            _Ty *end() noexcept { return ptr + count; }
+            const _Ty *end() const noexcept { return ptr + count; }
+            _Ty &operator[](size_t index) noexcept { return ptr[index]; }
+            const _Ty &operator[](size_t index) const noexcept { return ptr[index]; }
+
+            /// @brief Make room for size elements, spilling to the heap when size exceeds _N
+            void reserve(size_t size)
+            {
+                if (size <= reserved)
+                    return;
+                _Alloc alloc;
+                _Ty *block = Traits::allocate(alloc, size);
+                std::copy_n(ptr, count, block);
+                Release();
+                ptr = block;
+                reserved = size;
+            }
+            /// @brief Value-initializes new elements like std::vector, the capacity never shrinks
+            void resize(size_t size)
+            {
+                if (size > reserved)
+                    reserve(std::max(size, reserved * 2));
+                if (size > count)
+                    std::fill(ptr + count, ptr + size, _Ty());
+                count = size;
+            }
+        };
+#pragma endregion
+    }
+}
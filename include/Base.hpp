@@ -9,27 +9,37 @@
 #include <initializer_list>
 #include "LazyEvaluation.hpp"
 #include "Error.hpp"
+#include "Allocator.hpp"
+#include "Instrumentation.hpp"
 
 namespace LinerAlgebra
 {
-#define _TMP template <size_t, size_t, typename>
+#define _TMP template <size_t, size_t, typename, typename>
 
-    constexpr size_t Dynamic = 0;
+    /// @brief Element order of a stored matrix: rows or columns contiguous, for sparse storage CSR or CSC
+    enum class StorageOrder
+    {
+        RowMajor,
+        ColMajor
+    };
 
     constexpr bool isLittle(size_t row, size_t col)
     {
         return (row * col != 0 && row * col < 280) ? 1 : 0;
     }
 
-    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, size_t judge = isLittle(_Row, _Col)>
+    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, typename _Alloc, size_t judge = isLittle(_Row, _Col)>
     class Base;
 
     #pragma region "Matrix in heap"
-    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty>
-    class Base<Derived, _Row, _Col, _Ty, 0>
+    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    class Base<Derived, _Row, _Col, _Ty, _Alloc, 0> : public instrument::Tracked
     {
+    public:
+        using StorageType = std::vector<_Ty, instrument::StorageAllocator<_Alloc>>;
+
     protected:
-        std::vector<_Ty> elements;
+        StorageType elements;
         size_t row;
         size_t col;
         Base() : elements(_Row * _Col), row(_Row), col(_Col) {}
@@ -37,27 +47,60 @@ namespace LinerAlgebra
 
     public:
         constexpr static bool IsDynamic() { return _Row * _Col == 0; }
+        constexpr static bool IsInStack() { return false; }
+    };
+    #pragma endregion
+
+    #pragma region "Matrix with inline storage"
+    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, size_t _N, typename _Alloc>
+    class Base<Derived, _Row, _Col, _Ty, memory::InlineAllocator<_Ty, _N, _Alloc>, 0> : public instrument::Tracked
+    {
+    public:
+        using StorageType = memory::SmallVector<_Ty, _N, instrument::StorageAllocator<_Alloc>>;
+
+    protected:
+        StorageType elements;
+        size_t row;
+        size_t col;
+        Base() : elements(_Row * _Col), row(_Row), col(_Col) {}
+        Base(size_t row, size_t col) : Base()
+        {
+            if constexpr (IsDynamic())
+            {
+                elements.resize(row * col);
+                this->row = row;
+                this->col = col;
+            }
+        }
+
+    public:
+        constexpr static bool IsDynamic() { return _Row * _Col == 0; }
+        constexpr static bool IsInStack() { return false; }
     };
     #pragma endregion
 
     #pragma region "Matrix in stack"
-    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty>
-    class Base<Derived, _Row, _Col, _Ty, 1>
+    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    class Base<Derived, _Row, _Col, _Ty, _Alloc, 1> : public instrument::Tracked
     {
+    public:
+        using StorageType = std::array<_Ty, _Row * _Col>;
+
     protected:
-        std::array<_Ty, _Row * _Col> elements;
+        StorageType elements;
         size_t row;
         size_t col;
-        Base() : elements(), row(_Row), col(_Col) {}
-        Base(size_t row, size_t col) : elements(), row(_Row), col(_Col) {}
+        constexpr Base() : elements(), row(_Row), col(_Col) {}
+        constexpr Base(size_t row, size_t col) : elements(), row(_Row), col(_Col) {}
     public:
         constexpr static bool IsDynamic() { return false; }
+        constexpr static bool IsInStack() { return true; }
     };
     #pragma endregion
 
     #pragma region "Heap matrix function"
-    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty>
-    inline Base<Derived, _Row, _Col, _Ty, 0>::Base(size_t row, size_t col) : Base()
+    template <_TMP typename Derived, size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline Base<Derived, _Row, _Col, _Ty, _Alloc, 0>::Base(size_t row, size_t col) : Base()
     {
         if constexpr (IsDynamic())
         {
@@ -0,0 +1,963 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <utility>
+#include "Matrix.hpp"
+#include "Triangular.hpp"
+#include "Allocator.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+        /// @brief Columns factored per panel before the trailing matrix is updated with GEMM
+        constexpr size_t FactorBlock = 64;
+
+#pragma region "Cholesky kernels"
+        /// @brief Left-looking Cholesky of a n x n block, L overwrites the lower triangle
+        /// @tparam _N Fixed size to unroll the column loop, Dynamic otherwise
+        template <size_t _N, typename _Ty>
+        void CholeskyUnblocked(size_t n, StridedRef<_Ty> a)
+        {
+            StaticFor<_N>(n, [&](size_t j)
+                          {
+                _Ty d = a(j, j);
+                for (size_t p = 0; p < j; ++p)
+                    d -= a(j, p) * a(j, p);
+                if (!(d > _Ty(0)))
+                    throw NotPositiveDefiniteExcept();
+                d = std::sqrt(d);
+                a(j, j) = d;
+                const _Ty inv = _Ty(1) / d;
+                for (size_t i = j + 1; i < n; ++i)
+                {
+                    _Ty sum = a(i, j);
+                    for (size_t p = 0; p < j; ++p)
+                        sum -= a(i, p) * a(j, p);
+                    a(i, j) = sum * inv;
+                } });
+        }
+
+        /// @brief C -= A * Bᵀ on the lower triangle of the n x n block C, A and B are n x k.
+        /// The block below the diagonal halves goes to one GEMM and the halves recurse, so the products stay large;
+        /// a diagonal tile is computed aside and only its lower triangle is written back.
+        /// @param tile At least FactorBlock x FactorBlock elements
+        template <typename _Ty>
+        void SyrkLower(size_t n, size_t k, StridedRef<const _Ty> a, StridedRef<const _Ty> b, StridedRef<_Ty> c, _Ty *tile)
+        {
+            if (n <= FactorBlock)
+            {
+                const StridedRef<_Ty> t{tile, n, 1};
+                Gemm<_Ty>(n, n, k, _Ty(1), a, b.Transposed(), _Ty(0), t);
+                for (size_t i = 0; i < n; ++i)
+                    for (size_t j = 0; j <= i; ++j)
+                        c(i, j) -= t(i, j);
+                return;
+            }
+            const size_t half = std::max(FactorBlock, n / 2 / FactorBlock * FactorBlock);
+            SyrkLower<_Ty>(half, k, a, b, c, tile);
+            Gemm<_Ty>(n - half, half, k, _Ty(-1), a.Block(half, 0), b.Transposed(), _Ty(1), c.Block(half, 0));
+            SyrkLower<_Ty>(n - half, k, a.Block(half, 0), b.Block(half, 0), c.Block(half, half), tile);
+        }
+
+        /// @brief Right-looking blocked Cholesky, the strict upper triangle is left untouched
+        template <typename _Ty>
+        void CholeskyBlocked(size_t n, StridedRef<_Ty> a)
+        {
+            memory::ArenaScope scope;
+            std::vector<_Ty, memory::ArenaAllocator<_Ty>> tile(FactorBlock * FactorBlock);
+            for (size_t k0 = 0; k0 < n; k0 += FactorBlock)
+            {
+                const size_t kb = std::min(FactorBlock, n - k0);
+                CholeskyUnblocked<Dynamic>(kb, a.Block(k0, k0));
+                const size_t rest = n - k0 - kb;
+                if (rest == 0)
+                    break;
+                StridedRef<_Ty> l21 = a.Block(k0 + kb, k0);
+                // L21 = A21 * L11⁻ᵀ, row by row
+                TrsmLowerTransposedRight<_Ty>(rest, kb, a.Block(k0, k0), l21);
+                // A22 -= L21 * L21ᵀ, lower triangle only
+                SyrkLower<_Ty>(rest, kb, l21, l21, a.Block(k0 + kb, k0 + kb), tile.data());
+            }
+        }
+#pragma endregion
+
+#pragma region "LDLT kernels"
+        /// @brief Left-looking LDLᵀ of a n x n block, unit L below the diagonal and D on it
+        template <size_t _N, typename _Ty>
+        void LDLTUnblocked(size_t n, StridedRef<_Ty> a)
+        {
+            StaticFor<_N>(n, [&](size_t j)
+                          {
+                _Ty d = a(j, j);
+                for (size_t p = 0; p < j; ++p)
+                    d -= a(j, p) * a(j, p) * a(p, p);
+                if (d == _Ty(0))
+                    throw SingularExcept();
+                a(j, j) = d;
+                const _Ty inv = _Ty(1) / d;
+                for (size_t i = j + 1; i < n; ++i)
+                {
+                    _Ty sum = a(i, j);
+                    for (size_t p = 0; p < j; ++p)
+                        sum -= a(i, p) * a(j, p) * a(p, p);
+                    a(i, j) = sum * inv;
+                } });
+        }
+
+        /// @brief Right-looking blocked LDLᵀ without pivoting
+        template <typename _Ty>
+        void LDLTBlocked(size_t n, StridedRef<_Ty> a)
+        {
+            memory::ArenaScope scope;
+            std::vector<_Ty, memory::ArenaAllocator<_Ty>> work, tile(FactorBlock * FactorBlock);
+            for (size_t k0 = 0; k0 < n; k0 += FactorBlock)
+            {
+                const size_t kb = std::min(FactorBlock, n - k0);
+                LDLTUnblocked<Dynamic>(kb, a.Block(k0, k0));
+                const size_t rest = n - k0 - kb;
+                if (rest == 0)
+                    break;
+                StridedRef<_Ty> l21 = a.Block(k0 + kb, k0);
+                // W = A21 * L11⁻ᵀ = L21 * D1, row by row
+                TrsmLowerTransposedRight<_Ty>(rest, kb, a.Block(k0, k0), l21, true);
+                work.resize(rest * kb);
+                StridedRef<_Ty> w{work.data(), kb, 1};
+                for (size_t i = 0; i < rest; ++i)
+                {
+                    for (size_t p = 0; p < kb; ++p)
+                    {
+                        w(i, p) = l21(i, p);
+                        l21(i, p) /= a(k0 + p, k0 + p);
+                    }
+                }
+                // A22 -= L21 * D1 * L21ᵀ = L21 * Wᵀ, lower triangle only
+                SyrkLower<_Ty>(rest, kb, l21, w, a.Block(k0 + kb, k0 + kb), tile.data());
+            }
+        }
+#pragma endregion
+
+#pragma region "LU kernels"
+        /// @brief Partial-pivot LU of the panel of columns [k0, k0 + kb), rows are swapped across the whole matrix
+        /// @param pivots pivots[j] is the row exchanged with row j at step j
+        template <size_t _N, typename _Ty>
+        void LUPanel(size_t n, size_t k0, size_t kb, StridedRef<_Ty> a, size_t *pivots, int &sign)
+        {
+            StaticFor<_N>(kb, [&](size_t jj)
+                          {
+                const size_t j = k0 + jj;
+                size_t pivot = j;
+                for (size_t i = j + 1; i < n; ++i)
+                    if (Abs(a(i, j)) > Abs(a(pivot, j)))
+                        pivot = i;
+                if (a(pivot, j) == _Ty(0))
+                    throw SingularExcept();
+                pivots[j] = pivot;
+                if (pivot != j)
+                {
+                    for (size_t c = 0; c < n; ++c)
+                        std::swap(a(j, c), a(pivot, c));
+                    sign = -sign;
+                }
+                const _Ty inv = _Ty(1) / a(j, j);
+                for (size_t i = j + 1; i < n; ++i)
+                {
+                    const _Ty lij = a(i, j) *= inv;
+                    for (size_t c = j + 1; c < k0 + kb; ++c)
+                        a(i, c) -= lij * a(j, c);
+                } });
+        }
+
+        /// @brief Right-looking blocked LU with partial pivoting, PA = LU with unit L
+        template <size_t _N, typename _Ty>
+        void LUBlocked(size_t n, StridedRef<_Ty> a, size_t *pivots, int &sign)
+        {
+            sign = 1;
+            for (size_t k0 = 0; k0 < n; k0 += FactorBlock)
+            {
+                const size_t kb = std::min(FactorBlock, n - k0);
+                LUPanel<_N>(n, k0, kb, a, pivots, sign);
+                const size_t rest = n - k0 - kb;
+                if (rest == 0)
+                    break;
+                // U12 = L11⁻¹ * A12, then A22 -= L21 * U12
+                TrsmLower<_Ty>(kb, rest, a.Block(k0, k0), a.Block(k0, k0 + kb), true);
+                Gemm<_Ty>(rest, rest, kb, _Ty(-1), a.Block(k0 + kb, k0), a.Block(k0, k0 + kb), _Ty(1), a.Block(k0 + kb, k0 + kb));
+            }
+        }
+#pragma endregion
+
+#pragma region "QR kernels"
+        /// @brief Householder reflector H = I - tau * v * vᵀ, v = [1; x'], with H * [alpha; x] = [beta; 0].
+        /// beta overwrites alpha and x' overwrites x; tau = 0 when x is already zero.
+        /// @param x n x 1 column below alpha
+        template <typename _Ty>
+        _Ty Householder(size_t n, _Ty &alpha, StridedRef<_Ty> x)
+        {
+            _Ty norm2(0);
+            for (size_t i = 0; i < n; ++i)
+                norm2 += x(i, 0) * x(i, 0);
+            if (norm2 == _Ty(0))
+                return _Ty(0);
+            // beta takes the sign opposite to alpha, so alpha - beta never cancels
+            const _Ty norm = std::sqrt(alpha * alpha + norm2);
+            const _Ty beta = alpha >= _Ty(0) ? -norm : norm;
+            const _Ty scale = _Ty(1) / (alpha - beta);
+            for (size_t i = 0; i < n; ++i)
+                x(i, 0) *= scale;
+            const _Ty tau = (beta - alpha) / beta;
+            alpha = beta;
+            return tau;
+        }
+
+        /// @brief C = (I - tau * v * vᵀ) * C for the m x cols block C, v(0) = 1 is implied and never read.
+        /// Row by row, so a row-major C is streamed instead of walked down its columns.
+        /// @param work At least cols elements
+        template <typename _Ty>
+        void ApplyHouseholder(size_t m, size_t cols, StridedRef<const _Ty> v, _Ty tau, StridedRef<_Ty> c, _Ty *work)
+        {
+            if (tau == _Ty(0))
+                return;
+            for (size_t j = 0; j < cols; ++j)
+                work[j] = c(0, j);
+            for (size_t i = 1; i < m; ++i)
+            {
+                const _Ty vi = v(i, 0);
+                for (size_t j = 0; j < cols; ++j)
+                    work[j] += vi * c(i, j);
+            }
+            for (size_t j = 0; j < cols; ++j)
+            {
+                work[j] *= tau;
+                c(0, j) -= work[j];
+            }
+            for (size_t i = 1; i < m; ++i)
+            {
+                const _Ty vi = v(i, 0);
+                for (size_t j = 0; j < cols; ++j)
+                    c(i, j) -= vi * work[j];
+            }
+        }
+
+        /// @brief Householder QR of the first n columns of an m x cols block, each reflector is applied to every column.
+        /// R overwrites the upper triangle, the reflectors without their unit head the part below it.
+        /// @param work At least cols elements
+        template <typename _Ty>
+        void QRUnblocked(size_t m, size_t n, size_t cols, StridedRef<_Ty> a, _Ty *tau, _Ty *work)
+        {
+            for (size_t j = 0; j < n && j < m; ++j)
+            {
+                tau[j] = Householder(m - j - 1, a(j, j), a.Block(j + 1, j));
+                ApplyHouseholder<_Ty>(m - j, cols - j - 1, a.Block(j, j), tau[j], a.Block(j, j + 1), work);
+            }
+        }
+
+        /// @brief Explicit unit lower trapezoidal V (m x k) and upper triangular T (k x k) of the block reflector
+        /// H1 * H2 * ... * Hk = I - V * T * Vᵀ, from the reflectors stored below the diagonal of a
+        template <typename _Ty>
+        void BlockReflector(size_t m, size_t k, StridedRef<const _Ty> a, const _Ty *tau, StridedRef<_Ty> v, StridedRef<_Ty> t)
+        {
+            for (size_t i = 0; i < m; ++i)
+                for (size_t j = 0; j < k; ++j)
+                    v(i, j) = i > j ? a(i, j) : (i == j ? _Ty(1) : _Ty(0));
+            for (size_t j = 0; j < k; ++j)
+            {
+                // T(0:j, j) = -tau_j * T(0:j, 0:j) * V(:, 0:j)ᵀ * v_j
+                for (size_t i = 0; i < j; ++i)
+                {
+                    _Ty sum(0);
+                    for (size_t r = j; r < m; ++r)
+                        sum += v(r, i) * v(r, j);
+                    t(i, j) = sum;
+                }
+                for (size_t i = 0; i < j; ++i)
+                {
+                    _Ty sum(0);
+                    for (size_t l = i; l < j; ++l)
+                        sum += t(i, l) * t(l, j);
+                    t(i, j) = -tau[j] * sum;
+                }
+                t(j, j) = tau[j];
+                for (size_t i = j + 1; i < k; ++i)
+                    t(i, j) = _Ty(0);
+            }
+        }
+
+        /// @brief C = (I - V * T * Vᵀ)ᵀ * C for the m x cols block C, two GEMMs around a k x k triangular multiply
+        /// @param w At least k * cols elements
+        template <typename _Ty>
+        void ApplyBlockReflectorT(size_t m, size_t k, size_t cols, StridedRef<const _Ty> v, StridedRef<const _Ty> t, StridedRef<_Ty> c, _Ty *w)
+        {
+            const StridedRef<_Ty> W{w, cols, 1};
+            Gemm<_Ty>(k, cols, m, _Ty(1), v.Transposed(), c, _Ty(0), W);
+            // W = Tᵀ * W from the bottom row up, row i only reads rows above it
+            for (size_t i = k; i-- > 0;)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    _Ty sum(0);
+                    for (size_t l = 0; l <= i; ++l)
+                        sum += t(l, i) * W(l, j);
+                    W(i, j) = sum;
+                }
+            }
+            Gemm<_Ty>(m, cols, k, _Ty(-1), v, W, _Ty(1), c);
+        }
+
+        /// @brief Blocked Householder QR of the first n columns of an m x cols block: panels of FactorBlock columns
+        /// are factored unblocked, the rest of the block is updated with the compact WY form through GEMM
+        template <typename _Ty>
+        void QRBlocked(size_t m, size_t n, size_t cols, StridedRef<_Ty> a, _Ty *tau)
+        {
+            memory::ArenaScope scope;
+            lazy::ScratchBuffer<_Ty> work(cols), v, t(FactorBlock * FactorBlock), w;
+            for (size_t k0 = 0; k0 < n && k0 < m; k0 += FactorBlock)
+            {
+                const size_t kb = std::min({FactorBlock, n - k0, m - k0});
+                QRUnblocked<_Ty>(m - k0, kb, kb, a.Block(k0, k0), tau + k0, work.data());
+                const size_t rest = cols - k0 - kb;
+                if (rest == 0)
+                    continue;
+                v.resize((m - k0) * kb);
+                w.resize(kb * rest);
+                const StridedRef<_Ty> V{v.data(), kb, 1}, T{t.data(), kb, 1};
+                BlockReflector<_Ty>(m - k0, kb, a.Block(k0, k0), tau + k0, V, T);
+                ApplyBlockReflectorT<_Ty>(m - k0, kb, rest, V, T, a.Block(k0, k0 + kb), w.data());
+            }
+        }
+
+        /// @brief B = Qᵀ * B for the m x cols block B, Q given by the n reflectors stored below the diagonal of a
+        template <typename _Ty>
+        void ApplyQT(size_t m, size_t n, StridedRef<const _Ty> a, const _Ty *tau, size_t cols, StridedRef<_Ty> b)
+        {
+            memory::ArenaScope scope;
+            // building T costs as much as applying the block to FactorBlock columns, so narrow b stays unblocked
+            if (n <= FactorBlock || cols < FactorBlock)
+            {
+                lazy::ScratchBuffer<_Ty> work(cols);
+                for (size_t j = 0; j < n && j < m; ++j)
+                    ApplyHouseholder<_Ty>(m - j, cols, a.Block(j, j), tau[j], b.Block(j, 0), work.data());
+                return;
+            }
+            lazy::ScratchBuffer<_Ty> v, t(FactorBlock * FactorBlock), w;
+            for (size_t k0 = 0; k0 < n && k0 < m; k0 += FactorBlock)
+            {
+                const size_t kb = std::min({FactorBlock, n - k0, m - k0});
+                v.resize((m - k0) * kb);
+                w.resize(kb * cols);
+                const StridedRef<_Ty> V{v.data(), kb, 1}, T{t.data(), kb, 1};
+                BlockReflector<_Ty>(m - k0, kb, a.Block(k0, k0), tau + k0, V, T);
+                ApplyBlockReflectorT<_Ty>(m - k0, kb, cols, V, T, b.Block(k0, 0), w.data());
+            }
+        }
+
+        /// @brief Fold p new rows [A | B] into the triangular system [R | D] in place: after the call R and D
+        /// describe all rows seen so far and B holds the part of the new right-hand sides no x can fit
+        /// @param r n x n upper triangle, the strict lower part is never read
+        /// @param d n x k
+        /// @param a p x n, destroyed
+        /// @param b p x k
+        template <typename _Ty>
+        void QRUpdate(size_t n, size_t k, size_t p, StridedRef<_Ty> r, StridedRef<_Ty> d, StridedRef<_Ty> a, StridedRef<_Ty> b)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                // the reflector touches row j of [R | D] and every new row, R below row j is zero already
+                const _Ty tau = Householder(p, r(j, j), a.Block(0, j));
+                if (tau == _Ty(0))
+                    continue;
+                const auto reflect = [&](_Ty &head, StridedRef<_Ty> column)
+                {
+                    _Ty w = head;
+                    for (size_t i = 0; i < p; ++i)
+                        w += a(i, j) * column(i, 0);
+                    w *= tau;
+                    head -= w;
+                    for (size_t i = 0; i < p; ++i)
+                        column(i, 0) -= a(i, j) * w;
+                };
+                for (size_t c = j + 1; c < n; ++c)
+                    reflect(r(j, c), a.Block(0, c));
+                for (size_t c = 0; c < k; ++c)
+                    reflect(d(j, c), b.Block(0, c));
+            }
+        }
+#pragma endregion
+    }
+
+    namespace detail
+    {
+        /// @brief Pivots or reflector scales of a decomposition, from the same allocator as its matrix
+        template <typename _Mat, typename _Ty>
+        using AuxVector = std::vector<_Ty, typename std::allocator_traits<typename _Mat::AllocatorType>::template rebind_alloc<_Ty>>;
+        /// @brief Matrix of _Ty with the shape of _Shape, from the same allocator as _Mat
+        template <typename _Mat, typename _Ty, typename _Shape = _Mat>
+        using AuxMatrix = Matrix<_Shape::RowsAtCompileTime, _Shape::ColsAtCompileTime, _Ty,
+                                 typename std::allocator_traits<typename _Mat::AllocatorType>::template rebind_alloc<_Ty>>;
+
+        /// @brief Right-hand side as an owned matrix that a solver can overwrite
+        template <typename _Rhs>
+        auto EvaluateRhs(const _Rhs &rhs)
+        {
+            if constexpr (lazy::expression<_Rhs>)
+                return rhs.Eval();
+            else
+                return _Rhs(rhs);
+        }
+
+        template <typename _Mat>
+        kernel::StridedRef<typename _Mat::ValueType> RowMajor(_Mat &mat)
+        {
+            return {mat.Data(), mat.Col(), 1};
+        }
+        /// @brief A view is solved in place through its strides, e.g. a block of a larger matrix
+        template <typename _Ty, size_t _Rows, size_t _Cols>
+        kernel::StridedRef<_Ty> RowMajor(lazy::View<_Ty, _Rows, _Cols> &view)
+        {
+            return view.Target();
+        }
+
+        template <typename _Mat, typename _Ty>
+        void Factorize(_Mat &factor, const _Ty &a)
+        {
+            static_assert(lazy::DimMatch(_Mat::RowsAtCompileTime, _Mat::ColsAtCompileTime), "不是方阵!");
+            factor = a;
+            if (factor.Row() != factor.Col())
+                throw SizeExcept();
+        }
+
+        template <typename _Mat, typename _Rhs>
+        void CheckRhs(const _Mat &factor, const _Rhs &b)
+        {
+            static_assert(lazy::DimMatch(_Mat::RowsAtCompileTime, _Rhs::RowsAtCompileTime), "Matrices' size mismatch!");
+            if (b.Row() != factor.Row())
+                throw SizeExcept();
+        }
+    }
+
+    /// @brief Cholesky factorization A = L * Lᵀ of a symmetric positive definite matrix.
+    /// Only the lower triangle of A is read; the factor is kept for any number of solves.
+    template <typename _Mat>
+    class Cholesky
+    {
+        _Mat factor;
+
+    public:
+        using ValueType = typename _Mat::ValueType;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+
+        Cholesky() = default;
+        template <typename _Ty>
+        explicit Cholesky(const _Ty &a) { Compute(a); }
+
+        /// @brief Factor a matrix or expression, reusing the storage of a previous factorization
+        template <typename _Ty>
+        Cholesky &Compute(const _Ty &a)
+        {
+            detail::Factorize(factor, a);
+            if constexpr (kernel::Unrollable(RowsAtCompileTime, RowsAtCompileTime))
+                kernel::CholeskyUnblocked<RowsAtCompileTime>(RowsAtCompileTime, detail::RowMajor(factor));
+            else
+                kernel::CholeskyBlocked(factor.Row(), detail::RowMajor(factor));
+            return *this;
+        }
+
+        /// @brief Overwrite b with A⁻¹ * b
+        template <typename _Rhs>
+        void SolveInPlace(_Rhs &b) const
+        {
+            detail::CheckRhs(factor, b);
+            const kernel::StridedRef<const ValueType> l{factor.Data(), factor.Col(), 1};
+            kernel::TrsmLower<ValueType>(factor.Row(), b.Col(), l, detail::RowMajor(b));
+            kernel::TrsmUpper<ValueType>(factor.Row(), b.Col(), l.Transposed(), detail::RowMajor(b));
+        }
+
+        /// @brief A⁻¹ * rhs for a matrix or lazy expression
+        template <typename _Rhs>
+        auto Solve(const _Rhs &rhs) const
+        {
+            auto x = detail::EvaluateRhs(rhs);
+            SolveInPlace(x);
+            return x;
+        }
+
+        _Mat MatrixL() const
+        {
+            _Mat l = factor;
+            for (size_t i = 0; i < l.Row(); ++i)
+                for (size_t j = i + 1; j < l.Col(); ++j)
+                    l(i, j) = ValueType(0);
+            return l;
+        }
+
+        ValueType Determinant() const
+        {
+            ValueType det(1);
+            for (size_t i = 0; i < factor.Row(); ++i)
+                det *= factor(i, i) * factor(i, i);
+            return det;
+        }
+    };
+
+    /// @brief LDLᵀ factorization A = L * D * Lᵀ of a symmetric matrix, no square roots and no pivoting.
+    /// Only the lower triangle of A is read.
+    template <typename _Mat>
+    class LDLT
+    {
+        _Mat factor;
+
+    public:
+        using ValueType = typename _Mat::ValueType;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+
+        LDLT() = default;
+        template <typename _Ty>
+        explicit LDLT(const _Ty &a) { Compute(a); }
+
+        template <typename _Ty>
+        LDLT &Compute(const _Ty &a)
+        {
+            detail::Factorize(factor, a);
+            if constexpr (kernel::Unrollable(RowsAtCompileTime, RowsAtCompileTime))
+                kernel::LDLTUnblocked<RowsAtCompileTime>(RowsAtCompileTime, detail::RowMajor(factor));
+            else
+                kernel::LDLTBlocked(factor.Row(), detail::RowMajor(factor));
+            return *this;
+        }
+
+        template <typename _Rhs>
+        void SolveInPlace(_Rhs &b) const
+        {
+            detail::CheckRhs(factor, b);
+            const size_t n = factor.Row();
+            const kernel::StridedRef<const ValueType> l{factor.Data(), factor.Col(), 1};
+            kernel::TrsmLower<ValueType>(n, b.Col(), l, detail::RowMajor(b), true);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const ValueType inv = ValueType(1) / factor(i, i);
+                for (size_t j = 0; j < b.Col(); ++j)
+                    b(i, j) *= inv;
+            }
+            kernel::TrsmUpper<ValueType>(n, b.Col(), l.Transposed(), detail::RowMajor(b), true);
+        }
+
+        template <typename _Rhs>
+        auto Solve(const _Rhs &rhs) const
+        {
+            auto x = detail::EvaluateRhs(rhs);
+            SolveInPlace(x);
+            return x;
+        }
+
+        /// @brief Unit lower triangular factor
+        _Mat MatrixL() const
+        {
+            _Mat l = factor;
+            for (size_t i = 0; i < l.Row(); ++i)
+            {
+                l(i, i) = ValueType(1);
+                for (size_t j = i + 1; j < l.Col(); ++j)
+                    l(i, j) = ValueType(0);
+            }
+            return l;
+        }
+
+        /// @brief i-th entry of the diagonal factor D
+        ValueType D(size_t i) const { return factor(i, i); }
+    };
+
+    /// @brief LU factorization with partial pivoting, P * A = L * U
+    template <typename _Mat>
+    class LU
+    {
+    public:
+        using ValueType = typename _Mat::ValueType;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+
+    private:
+        using PivotType = std::conditional_t<lazy::IsFixed(RowsAtCompileTime), std::array<size_t, RowsAtCompileTime>, detail::AuxVector<_Mat, size_t>>;
+
+        _Mat factor;
+        PivotType pivots{};
+        int sign = 1;
+
+    public:
+        LU() = default;
+        template <typename _Ty>
+        explicit LU(const _Ty &a) { Compute(a); }
+
+        template <typename _Ty>
+        LU &Compute(const _Ty &a)
+        {
+            detail::Factorize(factor, a);
+            const size_t n = lazy::Extent<RowsAtCompileTime>(factor.Row());
+            if constexpr (!lazy::IsFixed(RowsAtCompileTime))
+                pivots.resize(n);
+            kernel::LUBlocked<RowsAtCompileTime>(n, detail::RowMajor(factor), pivots.data(), sign);
+            return *this;
+        }
+
+        template <typename _Rhs>
+        void SolveInPlace(_Rhs &b) const
+        {
+            detail::CheckRhs(factor, b);
+            const size_t n = factor.Row();
+            for (size_t i = 0; i < n; ++i)
+                if (pivots[i] != i)
+                    for (size_t j = 0; j < b.Col(); ++j)
+                        std::swap(b(i, j), b(pivots[i], j));
+            const kernel::StridedRef<const ValueType> lu{factor.Data(), factor.Col(), 1};
+            kernel::TrsmLower<ValueType>(n, b.Col(), lu, detail::RowMajor(b), true);
+            kernel::TrsmUpper<ValueType>(n, b.Col(), lu, detail::RowMajor(b));
+        }
+
+        template <typename _Rhs>
+        auto Solve(const _Rhs &rhs) const
+        {
+            auto x = detail::EvaluateRhs(rhs);
+            SolveInPlace(x);
+            return x;
+        }
+
+        ValueType Determinant() const
+        {
+            ValueType det(sign);
+            for (size_t i = 0; i < factor.Row(); ++i)
+                det *= factor(i, i);
+            return det;
+        }
+
+        _Mat Inverse() const
+        {
+            _Mat inv = _Mat::Identity(factor.Row());
+            SolveInPlace(inv);
+            return inv;
+        }
+    };
+
+    /// @brief Mixed-precision LU solver: A is factored in _Low and each solution is refined with residuals
+    /// computed in the precision of _Mat until it is as accurate as a working-precision LU would give.
+    /// The factorization and the solves run at the speed of _Low, one O(n²) residual per refinement step
+    /// is the only working-precision work. When A is too ill-conditioned (or too large in magnitude) for _Low,
+    /// A is factored again in working precision and every later solve uses that.
+    /// @tparam _Mat Square matrix type of A and of the solution precision
+    /// @tparam _Low Element type of the factors, float by default
+    template <typename _Mat, typename _Low = float>
+    class RefinedLU
+    {
+    public:
+        using ValueType = typename _Mat::ValueType;
+        using LowType = detail::AuxMatrix<_Mat, _Low>;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+        /// @brief Refinement steps a solve takes before it falls back to working precision
+        static constexpr size_t MaxIterations = 30;
+
+    private:
+        _Mat a;
+        LU<LowType> low;
+        // ‖A‖∞, the scale of the residuals a working-precision solve leaves
+        ValueType norm = ValueType(0);
+        // a solve that stops converging falls back to working precision, so the fallback is not part of the logical state
+        mutable LU<_Mat> full;
+        mutable bool isFull = false;
+        mutable size_t iterations = 0;
+
+        void FactorFull() const
+        {
+            full.Compute(a);
+            isFull = true;
+        }
+
+    public:
+        RefinedLU() = default;
+        template <typename _Ty>
+        explicit RefinedLU(const _Ty &m) { Compute(m); }
+
+        template <typename _Ty>
+        RefinedLU &Compute(const _Ty &m)
+        {
+            detail::Factorize(a, m);
+            const size_t n = a.Row();
+            norm = ValueType(0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                ValueType rowSum(0);
+                for (size_t j = 0; j < n; ++j)
+                    rowSum += std::abs(a(i, j));
+                norm = std::max(norm, rowSum);
+            }
+            isFull = false;
+            iterations = 0;
+            if (!(a.MaxAbs() <= ValueType(std::numeric_limits<_Low>::max())))
+            {
+                FactorFull();
+                return *this;
+            }
+            try
+            {
+                low.Compute(a);
+            }
+            catch (const SingularExcept &)
+            {
+                // singular once rounded to _Low, A may still be solvable in working precision
+                FactorFull();
+            }
+            return *this;
+        }
+
+        /// @brief x = A⁻¹ * b to working precision. Stops once every column's residual is within
+        /// √n · ε · ‖A‖∞ · ‖x‖∞, the backward error of a working-precision LU solve,
+        /// and falls back to working precision when a step stops converging.
+        template <typename _Rhs>
+        auto Solve(const _Rhs &rhs) const
+        {
+            auto b = detail::EvaluateRhs(rhs);
+            using RhsType = decltype(b);
+            using RhsLowType = detail::AuxMatrix<_Mat, _Low, RhsType>;
+            detail::CheckRhs(a, b);
+            iterations = 0;
+            if (isFull)
+            {
+                full.SolveInPlace(b);
+                return b;
+            }
+            const size_t n = a.Row(), k = b.Col();
+            const ValueType tolerance = std::sqrt(ValueType(n)) * std::numeric_limits<ValueType>::epsilon() * norm;
+            RhsLowType d(n, k);
+            d = b;
+            low.SolveInPlace(d);
+            RhsType x(n, k), r(n, k);
+            x = d;
+            ValueType previous = std::numeric_limits<ValueType>::infinity();
+            for (; iterations <= MaxIterations; ++iterations)
+            {
+                r = b;
+                r.NoAlias() -= a * x;
+                bool converged = true, finite = true;
+                ValueType worst(0);
+                for (size_t j = 0; j < k && finite; ++j)
+                {
+                    ValueType rNorm(0), xNorm(0);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        finite = finite && std::isfinite(r(i, j)) && std::isfinite(x(i, j));
+                        rNorm = std::max(rNorm, std::abs(r(i, j)));
+                        xNorm = std::max(xNorm, std::abs(x(i, j)));
+                    }
+                    converged = converged && rNorm <= tolerance * xNorm;
+                    worst = std::max(worst, rNorm);
+                }
+                if (finite && converged)
+                    return x;
+                // an overflow in the _Low factors never recovers, and a step that does not halve
+                // the residual means the error of the _Low solves is about as large as the correction
+                if (!finite || iterations == MaxIterations || worst > previous / 2)
+                    break;
+                previous = worst;
+                d = r;
+                low.SolveInPlace(d);
+                x += d;
+            }
+            // refinement stalled: A is too ill-conditioned for _Low
+            FactorFull();
+            full.SolveInPlace(b);
+            return b;
+        }
+
+        /// @brief Refinement steps of the last solve, 0 when the first low-precision solution was accurate
+        size_t Iterations() const noexcept { return iterations; }
+        /// @brief Whether solves have fallen back to a working-precision factorization
+        bool IsFullPrecision() const noexcept { return isFull; }
+    };
+
+    /// @brief Overwrite b with L⁻¹ * b for a square lower triangular l, the strict upper part is never read
+    template <typename _Mat, typename _Rhs>
+    void SolveLowerInPlace(const _Mat &l, _Rhs &&b, bool unitDiag = false)
+    {
+        detail::CheckRhs(l, b);
+        if (l.Row() != l.Col())
+            throw SizeExcept();
+        kernel::TrsmLower<typename _Mat::ValueType>(l.Row(), b.Col(), {l.Data(), l.Col(), 1}, detail::RowMajor(b), unitDiag);
+    }
+
+    /// @brief Overwrite b with U⁻¹ * b for a square upper triangular u, the strict lower part is never read
+    template <typename _Mat, typename _Rhs>
+    void SolveUpperInPlace(const _Mat &u, _Rhs &&b, bool unitDiag = false)
+    {
+        detail::CheckRhs(u, b);
+        if (u.Row() != u.Col())
+            throw SizeExcept();
+        kernel::TrsmUpper<typename _Mat::ValueType>(u.Row(), b.Col(), {u.Data(), u.Col(), 1}, detail::RowMajor(b), unitDiag);
+    }
+
+    /// @brief Householder QR A = Q * R of an m x n matrix with m >= n, blocked with the compact WY form above
+    /// kernel::FactorBlock columns. Q is kept as its reflectors below R, Solve gives least-squares solutions.
+    template <typename _Mat>
+    class QR
+    {
+    public:
+        using ValueType = typename _Mat::ValueType;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+        static constexpr size_t ColsAtCompileTime = _Mat::ColsAtCompileTime;
+        using MatrixRType = Matrix<ColsAtCompileTime, ColsAtCompileTime, ValueType, typename _Mat::AllocatorType>;
+
+    private:
+        using TauType = std::conditional_t<lazy::IsFixed(ColsAtCompileTime), std::array<ValueType, ColsAtCompileTime>, detail::AuxVector<_Mat, ValueType>>;
+
+        _Mat factor;
+        TauType tau{};
+
+    public:
+        QR() = default;
+        template <typename _Ty>
+        explicit QR(const _Ty &a) { Compute(a); }
+
+        /// @brief Factor a matrix or expression, reusing the storage of a previous factorization
+        template <typename _Ty>
+        QR &Compute(const _Ty &a)
+        {
+            factor = a;
+            const size_t m = factor.Row(), n = factor.Col();
+            if (m < n)
+                throw SizeExcept();
+            if constexpr (!lazy::IsFixed(ColsAtCompileTime))
+                tau.resize(n);
+            if (n <= kernel::FactorBlock)
+            {
+                std::array<ValueType, kernel::FactorBlock> work;
+                kernel::QRUnblocked<ValueType>(m, n, n, detail::RowMajor(factor), tau.data(), work.data());
+            }
+            else
+                kernel::QRBlocked<ValueType>(m, n, n, detail::RowMajor(factor), tau.data());
+            return *this;
+        }
+
+        /// @brief Overwrite the m-row b with Qᵀ * b, its first n rows are then R * x and the rest the residual
+        template <typename _Rhs>
+        void ApplyQT(_Rhs &&b) const
+        {
+            detail::CheckRhs(factor, b);
+            kernel::ApplyQT<ValueType>(factor.Row(), factor.Col(), {factor.Data(), factor.Col(), 1}, tau.data(), b.Col(), detail::RowMajor(b));
+        }
+
+        /// @brief x minimizing ‖A * x - rhs‖ for every column of rhs, n x k
+        template <typename _Rhs>
+        auto Solve(const _Rhs &rhs) const
+        {
+            auto y = detail::EvaluateRhs(rhs);
+            ApplyQT(y);
+            constexpr size_t cols = std::remove_cvref_t<decltype(y)>::ColsAtCompileTime;
+            constexpr bool fixed = lazy::IsFixed(ColsAtCompileTime) && lazy::IsFixed(cols);
+            Matrix<fixed ? ColsAtCompileTime : Dynamic, fixed ? cols : Dynamic, ValueType, typename _Mat::AllocatorType> x(factor.Col(), y.Col());
+            std::copy_n(y.Data(), x.Size(), x.Data());
+            kernel::TrsmUpper<ValueType>(factor.Col(), x.Col(), {factor.Data(), factor.Col(), 1}, detail::RowMajor(x));
+            return x;
+        }
+
+        /// @brief Upper triangular n x n factor
+        MatrixRType MatrixR() const
+        {
+            const size_t n = factor.Col();
+            MatrixRType r(n, n);
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = i; j < n; ++j)
+                    r(i, j) = factor(i, j);
+            return r;
+        }
+    };
+
+    /// @brief Least squares over observation rows that arrive over time, e.g. one chunk of a batch or one epoch at a time.
+    /// Only the n x n triangle R and Qᵀ * b are kept and updated with Householder reflections,
+    /// so adding p rows costs O(p * n²) and never refactors the rows already seen.
+    /// @tparam _Mat n x n matrix type of R, e.g. Matrix<4, 4> or DMatrix<>
+    /// @tparam _Rhs n x k matrix type of the transformed right-hand sides
+    template <typename _Mat, typename _Rhs = Matrix<_Mat::RowsAtCompileTime, lazy::IsFixed(_Mat::RowsAtCompileTime) ? 1 : Dynamic,
+                                                    typename _Mat::ValueType, typename _Mat::AllocatorType>>
+    class IncrementalQR
+    {
+    public:
+        using ValueType = typename _Mat::ValueType;
+        static constexpr size_t RowsAtCompileTime = _Mat::RowsAtCompileTime;
+
+    private:
+        _Mat r;
+        _Rhs d;
+        ValueType residual = ValueType(0);
+        size_t rows = 0;
+
+    public:
+        /// @brief No rows yet, R and Qᵀ * b start at zero
+        IncrementalQR() : IncrementalQR(RowsAtCompileTime, lazy::Extent<_Rhs::ColsAtCompileTime>(1)) {}
+        /// @param n Unknowns
+        /// @param k Right-hand sides
+        IncrementalQR(size_t n, size_t k) : r(n, n), d(n, k)
+        {
+            static_assert(lazy::DimMatch(_Mat::RowsAtCompileTime, _Mat::ColsAtCompileTime), "不是方阵!");
+            if (r.Row() != r.Col() || d.Row() != r.Row())
+                throw SizeExcept();
+            std::fill_n(r.Data(), r.Size(), ValueType(0));
+            std::fill_n(d.Data(), d.Size(), ValueType(0));
+        }
+
+        /// @brief Fold the observation rows A * x = b into the solution, a is p x n and b is p x k
+        template <typename _A, typename _B>
+        IncrementalQR &Add(const _A &a, const _B &b)
+        {
+            auto rowsA = detail::EvaluateRhs(a);
+            auto rowsB = detail::EvaluateRhs(b);
+            const size_t n = r.Row(), k = d.Col(), p = rowsA.Row();
+            if (rowsA.Col() != n || rowsB.Row() != p || rowsB.Col() != k)
+                throw SizeExcept();
+            kernel::QRUpdate<ValueType>(n, k, p, detail::RowMajor(r), detail::RowMajor(d), detail::RowMajor(rowsA), detail::RowMajor(rowsB));
+            for (size_t i = 0; i < rowsB.Size(); ++i)
+                residual += rowsB.Data()[i] * rowsB.Data()[i];
+            rows += p;
+            return *this;
+        }
+
+        /// @brief x minimizing ‖A * x - b‖ over every row added so far, SingularExcept while R is rank deficient
+        _Rhs Solve() const
+        {
+            for (size_t i = 0; i < r.Row(); ++i)
+                if (r(i, i) == ValueType(0))
+                    throw SingularExcept();
+            _Rhs x = d;
+            kernel::TrsmUpper<ValueType>(r.Row(), x.Col(), {r.Data(), r.Col(), 1}, detail::RowMajor(x));
+            return x;
+        }
+
+        /// @brief Upper triangular factor of every row so far, Rᵀ * R is the normal matrix Aᵀ * A
+        const _Mat &MatrixR() const noexcept { return r; }
+        /// @brief First n rows of Qᵀ * b
+        const _Rhs &QtB() const noexcept { return d; }
+        /// @brief ‖A * x - b‖² at the solution, summed over the right-hand sides
+        ValueType ResidualSquaredNorm() const noexcept { return residual; }
+        size_t Rows() const noexcept { return rows; }
+    };
+
+#pragma region "Deduction guides"
+    template <lazy::matrix _Mat>
+    Cholesky(const _Mat &) -> Cholesky<_Mat>;
+    template <lazy::expression _Expr>
+    Cholesky(const _Expr &) -> Cholesky<decltype(std::declval<const _Expr &>().Eval())>;
+    template <lazy::matrix _Mat>
+    LDLT(const _Mat &) -> LDLT<_Mat>;
+    template <lazy::expression _Expr>
+    LDLT(const _Expr &) -> LDLT<decltype(std::declval<const _Expr &>().Eval())>;
+    template <lazy::matrix _Mat>
+    LU(const _Mat &) -> LU<_Mat>;
+    template <lazy::expression _Expr>
+    LU(const _Expr &) -> LU<decltype(std::declval<const _Expr &>().Eval())>;
+    template <lazy::matrix _Mat>
+    RefinedLU(const _Mat &) -> RefinedLU<_Mat>;
+    template <lazy::expression _Expr>
+    RefinedLU(const _Expr &) -> RefinedLU<decltype(std::declval<const _Expr &>().Eval())>;
+    template <lazy::matrix _Mat>
+    QR(const _Mat &) -> QR<_Mat>;
+    template <lazy::expression _Expr>
+    QR(const _Expr &) -> QR<decltype(std::declval<const _Expr &>().Eval())>;
+#pragma endregion
+}
@@ -12,4 +12,40 @@ namespace LinerAlgebra
             return "Matrices' size mismatch!";
         }
     };
+
+    class SingularExcept : public std::exception
+    {
+    public:
+        const char* what() const throw()
+        {
+            return "Matrix is singular!";
+        }
+    };
+
+    class NotPositiveDefiniteExcept : public std::exception
+    {
+    public:
+        const char* what() const throw()
+        {
+            return "Matrix is not positive definite!";
+        }
+    };
+
+    class FileExcept : public std::exception
+    {
+    public:
+        const char* what() const throw()
+        {
+            return "Matrix file cannot be read or written!";
+        }
+    };
+
+    class ParseExcept : public std::exception
+    {
+    public:
+        const char* what() const throw()
+        {
+            return "Matrix text cannot be parsed!";
+        }
+    };
 }
\ No newline at end of file
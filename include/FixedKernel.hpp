@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include "Error.hpp"
+#include "Simd.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+        /// @brief Largest extent handled by the fully unrolled kernels
+        constexpr size_t MaxUnroll = 16;
+
+        constexpr bool Unrollable(size_t rows, size_t cols)
+        {
+            return rows != 0 && cols != 0 && rows <= MaxUnroll && cols <= MaxUnroll;
+        }
+
+        /// @brief Call func(integral_constant<0>) ... func(integral_constant<_N - 1>) without a loop
+        template <size_t _N, typename _Func>
+        constexpr void Unroll(_Func &&func)
+        {
+            [&]<size_t... _I>(std::index_sequence<_I...>)
+            {
+                (func(std::integral_constant<size_t, _I>{}), ...);
+            }(std::make_index_sequence<_N>{});
+        }
+
+        /// @brief for (k = 0; k < n; ++k) body(k), unrolled when _N is a fixed extent up to MaxUnroll
+        template <size_t _N, typename _Func>
+        constexpr void StaticFor(size_t n, _Func &&body)
+        {
+            if constexpr (Unrollable(_N, 1))
+                Unroll<_N>(body);
+            else
+                for (size_t k = 0; k < n; ++k)
+                    body(k);
+        }
+
+        template <typename _Ty>
+        constexpr _Ty Abs(_Ty x)
+        {
+            return x < _Ty(0) ? -x : x;
+        }
+
+#pragma region "Fixed-size kernels"
+        /// @brief dst = I, _N x _N row-major
+        template <size_t _N, typename _Ty>
+        constexpr void FixedIdentity(_Ty *dst)
+        {
+            Unroll<_N * _N>([&](auto index)
+                            { dst[index] = (index / _N == index % _N) ? _Ty(1) : _Ty(0); });
+        }
+
+        /// @brief dst(_Col x _Row) = src(_Row x _Col)ᵀ, dst must not alias src
+        template <size_t _Row, size_t _Col, typename _Ty>
+        constexpr void FixedTranspose(const _Ty *src, _Ty *dst)
+        {
+            Unroll<_Row * _Col>([&](auto index)
+                                { dst[index % _Col * _Row + index / _Col] = src[index]; });
+        }
+
+        /// @brief dst(_Row x _Col) = lhs(_Row x _K) * rhs(_K x _Col), dst must not alias lhs or rhs.
+        /// A row of dst is summed in packets, lhs(i, p) broadcast times row p of rhs, with a scalar tail past the
+        /// last full packet. The loops have constant trip counts and are left for the compiler to unroll, since
+        /// nested Unroll lambdas stop being inlined around 7 x 7. Narrower than a packet, or in a constant
+        /// evaluation, every dot product is a fold.
+        template <size_t _Row, size_t _K, size_t _Col, typename _Ty>
+        constexpr void FixedProduct(const _Ty *lhs, const _Ty *rhs, _Ty *dst)
+        {
+            using Packet = simd::Packet<_Ty>;
+            constexpr size_t width = Packet::Size;
+            constexpr size_t packets = _Col / width, tail = _Col - packets * width;
+            if constexpr (packets > 0)
+            {
+                if (!std::is_constant_evaluated())
+                {
+                    for (size_t i = 0; i < _Row; ++i)
+                    {
+                        Packet sums[packets];
+                        _Ty rest[tail + 1] = {};
+                        for (size_t g = 0; g < packets; ++g)
+                            sums[g] = simd::Set1(_Ty(0));
+                        for (size_t p = 0; p < _K; ++p)
+                        {
+                            const _Ty aip = lhs[i * _K + p];
+                            const Packet a = simd::Set1(aip);
+                            const _Ty *row = rhs + p * _Col;
+                            for (size_t g = 0; g < packets; ++g)
+                                sums[g] = simd::Add(sums[g], simd::Mul(a, simd::Load(row + g * width)));
+                            for (size_t j = 0; j < tail; ++j)
+                                rest[j] += aip * row[packets * width + j];
+                        }
+                        for (size_t g = 0; g < packets; ++g)
+                            simd::Store(dst + i * _Col + g * width, sums[g]);
+                        for (size_t j = 0; j < tail; ++j)
+                            dst[i * _Col + packets * width + j] = rest[j];
+                    }
+                    return;
+                }
+            }
+            Unroll<_Row * _Col>([&](auto index)
+                                {
+                constexpr size_t i = decltype(index)::value / _Col;
+                constexpr size_t j = decltype(index)::value % _Col;
+                dst[index] = [&]<size_t... _P>(std::index_sequence<_P...>)
+                {
+                    return ((lhs[i * _K + _P] * rhs[_P * _Col + j]) + ...);
+                }(std::make_index_sequence<_K>{}); });
+        }
+
+        /// @brief dst = src⁻¹ for a _N x _N matrix, closed form up to 3 x 3 and Gauss-Jordan with partial pivoting above
+        template <size_t _N, typename _Ty>
+        constexpr void FixedInverse(const _Ty *src, _Ty *dst)
+        {
+            if constexpr (_N == 1)
+            {
+                if (src[0] == _Ty(0))
+                    throw SingularExcept();
+                dst[0] = _Ty(1) / src[0];
+            }
+            else if constexpr (_N == 2)
+            {
+                const _Ty det = src[0] * src[3] - src[1] * src[2];
+                if (det == _Ty(0))
+                    throw SingularExcept();
+                const _Ty inv = _Ty(1) / det;
+                dst[0] = src[3] * inv;
+                dst[1] = -src[1] * inv;
+                dst[2] = -src[2] * inv;
+                dst[3] = src[0] * inv;
+            }
+            else if constexpr (_N == 3)
+            {
+                const _Ty c0 = src[4] * src[8] - src[5] * src[7];
+                const _Ty c1 = src[5] * src[6] - src[3] * src[8];
+                const _Ty c2 = src[3] * src[7] - src[4] * src[6];
+                const _Ty det = src[0] * c0 + src[1] * c1 + src[2] * c2;
+                if (det == _Ty(0))
+                    throw SingularExcept();
+                const _Ty inv = _Ty(1) / det;
+                dst[0] = c0 * inv;
+                dst[1] = (src[2] * src[7] - src[1] * src[8]) * inv;
+                dst[2] = (src[1] * src[5] - src[2] * src[4]) * inv;
+                dst[3] = c1 * inv;
+                dst[4] = (src[0] * src[8] - src[2] * src[6]) * inv;
+                dst[5] = (src[2] * src[3] - src[0] * src[5]) * inv;
+                dst[6] = c2 * inv;
+                dst[7] = (src[1] * src[6] - src[0] * src[7]) * inv;
+                dst[8] = (src[0] * src[4] - src[1] * src[3]) * inv;
+            }
+            else
+            {
+                _Ty work[_N * _N] = {};
+                Unroll<_N * _N>([&](auto index)
+                                { work[index] = src[index]; });
+                FixedIdentity<_N>(dst);
+                for (size_t k = 0; k < _N; ++k)
+                {
+                    size_t pivot = k;
+                    for (size_t i = k + 1; i < _N; ++i)
+                        if (Abs(work[i * _N + k]) > Abs(work[pivot * _N + k]))
+                            pivot = i;
+                    if (work[pivot * _N + k] == _Ty(0))
+                        throw SingularExcept();
+                    if (pivot != k)
+                    {
+                        for (size_t j = 0; j < _N; ++j)
+                        {
+                            std::swap(work[k * _N + j], work[pivot * _N + j]);
+                            std::swap(dst[k * _N + j], dst[pivot * _N + j]);
+                        }
+                    }
+                    const _Ty inv = _Ty(1) / work[k * _N + k];
+                    for (size_t j = 0; j < _N; ++j)
+                    {
+                        work[k * _N + j] *= inv;
+                        dst[k * _N + j] *= inv;
+                    }
+                    for (size_t i = 0; i < _N; ++i)
+                    {
+                        if (i == k)
+                            continue;
+                        const _Ty factor = work[i * _N + k];
+                        for (size_t j = 0; j < _N; ++j)
+                        {
+                            work[i * _N + j] -= factor * work[k * _N + j];
+                            dst[i * _N + j] -= factor * dst[k * _N + j];
+                        }
+                    }
+                }
+            }
+        }
+#pragma endregion
+    }
+}
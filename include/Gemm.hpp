@@ -0,0 +1,451 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "Allocator.hpp"
+#include "Simd.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+        /// @brief Pointer with independent row and column strides
+        /// @tparam _Ty Element Type
+        template <typename _Ty>
+        struct StridedRef
+        {
+            _Ty *data;
+            size_t rowStride;
+            size_t colStride;
+
+            constexpr _Ty &operator()(size_t row, size_t col) const { return data[row * rowStride + col * colStride]; }
+            /// @brief View starting at (row, col) with the same strides
+            constexpr StridedRef Block(size_t row, size_t col) const { return {&(*this)(row, col), rowStride, colStride}; }
+            /// @brief The same elements read as the transposed matrix
+            constexpr StridedRef Transposed() const { return {data, colStride, rowStride}; }
+            constexpr operator StridedRef<const _Ty>() const { return {data, rowStride, colStride}; }
+        };
+
+        /// @brief Register and cache tile sizes of the packed GEMM
+        /// @tparam _Ty Element Type
+        template <typename _Ty>
+        struct GemmBlocking
+        {
+            // MR x NR accumulators live in registers, a KC x NR panel of B in L1,
+            // a MC x KC block of A in L2 and a KC x NC block of B in L3.
+            static constexpr size_t MR = 4;
+            static constexpr size_t NR = 64 / sizeof(_Ty);
+            static constexpr size_t KC = 256;
+            static constexpr size_t MC = 96;
+            static constexpr size_t NC = 2048;
+            // Below this many multiply-adds packing costs more than it saves, as long as the rows of B and C are
+            // unit-stride; a strided unpacked loop does not vectorize and only wins on the tiniest products
+            static constexpr size_t SmallWork = 24 * 24 * 24;
+            static constexpr size_t SmallStridedWork = 6 * 6 * 6;
+        };
+
+#pragma region "Gemm implementation"
+        template <typename _Ty>
+        inline void ScaleTile(size_t m, size_t n, _Ty beta, StridedRef<_Ty> c)
+        {
+            if (beta == _Ty(1))
+                return;
+            for (size_t i = 0; i < m; ++i)
+                for (size_t j = 0; j < n; ++j)
+                    c(i, j) = (beta == _Ty(0)) ? _Ty(0) : beta * c(i, j);
+        }
+
+        /// @brief Pack a mc x kc block of A into MR-row panels, zero padding the last panel
+        template <typename _Ty>
+        inline void PackA(size_t mc, size_t kc, StridedRef<const _Ty> a, _Ty *buffer)
+        {
+            constexpr size_t MR = GemmBlocking<_Ty>::MR;
+            for (size_t ir = 0; ir < mc; ir += MR)
+            {
+                const size_t mr = std::min(MR, mc - ir);
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    for (size_t i = 0; i < mr; ++i)
+                        buffer[i] = a(ir + i, p);
+                    for (size_t i = mr; i < MR; ++i)
+                        buffer[i] = _Ty(0);
+                    buffer += MR;
+                }
+            }
+        }
+
+        /// @brief Pack a kc x nc block of B into NR-column panels, zero padding the last panel
+        template <typename _Ty>
+        inline void PackB(size_t kc, size_t nc, StridedRef<const _Ty> b, _Ty *buffer)
+        {
+            constexpr size_t NR = GemmBlocking<_Ty>::NR;
+            for (size_t jr = 0; jr < nc; jr += NR)
+            {
+                const size_t nr = std::min(NR, nc - jr);
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    for (size_t j = 0; j < nr; ++j)
+                        buffer[j] = b(p, jr + j);
+                    for (size_t j = nr; j < NR; ++j)
+                        buffer[j] = _Ty(0);
+                    buffer += NR;
+                }
+            }
+        }
+
+        /// @brief C(mr x nr) += alpha * A_panel * B_panel
+        template <typename _Ty>
+        inline void MicroKernel(size_t kc, size_t mr, size_t nr, _Ty alpha, const _Ty *a, const _Ty *b, StridedRef<_Ty> c)
+        {
+            constexpr size_t MR = GemmBlocking<_Ty>::MR;
+            constexpr size_t NR = GemmBlocking<_Ty>::NR;
+            alignas(64) _Ty acc[MR][NR] = {};
+            if constexpr (std::is_same_v<_Ty, float> || std::is_same_v<_Ty, double>)
+            {
+                // explicit packets: left to the loop vectorizer, -O3 turns the float kernel into shuffles
+                constexpr size_t width = simd::Packet<_Ty>::Size;
+                constexpr size_t packets = NR / width;
+                simd::Packet<_Ty> sums[MR][packets];
+                for (size_t i = 0; i < MR; ++i)
+                    for (size_t j = 0; j < packets; ++j)
+                        sums[i][j] = simd::Set1(_Ty(0));
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    simd::Packet<_Ty> row[packets];
+                    for (size_t j = 0; j < packets; ++j)
+                        row[j] = simd::Load(b + j * width);
+                    for (size_t i = 0; i < MR; ++i)
+                    {
+                        const simd::Packet<_Ty> ai = simd::Set1(a[i]);
+                        for (size_t j = 0; j < packets; ++j)
+                            sums[i][j] = simd::Add(sums[i][j], simd::Mul(ai, row[j]));
+                    }
+                    a += MR;
+                    b += NR;
+                }
+                for (size_t i = 0; i < MR; ++i)
+                    for (size_t j = 0; j < packets; ++j)
+                        simd::Store(acc[i] + j * width, sums[i][j]);
+            }
+            else
+            {
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    for (size_t i = 0; i < MR; ++i)
+                    {
+                        const _Ty ai = a[i];
+                        for (size_t j = 0; j < NR; ++j)
+                            acc[i][j] += ai * b[j];
+                    }
+                    a += MR;
+                    b += NR;
+                }
+            }
+            for (size_t i = 0; i < mr; ++i)
+                for (size_t j = 0; j < nr; ++j)
+                    c(i, j) += alpha * acc[i][j];
+        }
+
+        /// @brief Unpacked i-p-j loop for products too small to amortize packing
+        template <typename _Ty>
+        inline void GemmSmall(size_t m, size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, StridedRef<_Ty> c)
+        {
+            for (size_t i = 0; i < m; ++i)
+            {
+                if (b.colStride == 1 && c.colStride == 1)
+                {
+                    _Ty *row = &c(i, 0);
+                    for (size_t p = 0; p < k; ++p)
+                    {
+                        const _Ty aip = alpha * a(i, p);
+                        const _Ty *brow = &b(p, 0);
+                        for (size_t j = 0; j < n; ++j)
+                            row[j] += aip * brow[j];
+                    }
+                    continue;
+                }
+                for (size_t p = 0; p < k; ++p)
+                {
+                    const _Ty aip = alpha * a(i, p);
+                    for (size_t j = 0; j < n; ++j)
+                        c(i, j) += aip * b(p, j);
+                }
+            }
+        }
+
+        /// @brief c += alpha * A * b for a single column b, the shape of a solve with one right-hand side.
+        /// Packing A would cost as much as the product, so rows are dotted in place with independent lanes.
+        template <typename _Ty>
+        inline void Gemv(size_t m, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, StridedRef<_Ty> c)
+        {
+            constexpr size_t Lanes = 8;
+            for (size_t i = 0; i < m; ++i)
+            {
+                _Ty acc[Lanes] = {};
+                size_t p = 0;
+                if (a.colStride == 1 && b.rowStride == 1)
+                {
+                    const _Ty *row = &a(i, 0), *col = &b(0, 0);
+                    for (; p + Lanes <= k; p += Lanes)
+                        for (size_t lane = 0; lane < Lanes; ++lane)
+                            acc[lane] += row[p + lane] * col[p + lane];
+                }
+                for (; p < k; ++p)
+                    acc[p % Lanes] += a(i, p) * b(p, 0);
+                _Ty sum(0);
+                for (size_t lane = 0; lane < Lanes; ++lane)
+                    sum += acc[lane];
+                c(i, 0) += alpha * sum;
+            }
+        }
+
+        /// @brief The packed loop nest of Gemm on a scaled C, skipping register tiles below the diagonal when _Upper
+        template <typename _Ty, bool _Upper>
+        void GemmPacked(size_t m, size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, StridedRef<_Ty> c)
+        {
+            using Blocking = GemmBlocking<_Ty>;
+            const size_t kcMax = std::min(Blocking::KC, k);
+            const size_t mcMax = std::min(Blocking::MC, m);
+            const size_t ncMax = std::min(Blocking::NC, n);
+            // grow-only per-thread panels: a steady stream of products does not touch the allocator
+            thread_local std::vector<_Ty, memory::AlignedAllocator<_Ty>> packedA, packedB;
+            const size_t sizeA = (mcMax + Blocking::MR - 1) / Blocking::MR * Blocking::MR * kcMax;
+            const size_t sizeB = (ncMax + Blocking::NR - 1) / Blocking::NR * Blocking::NR * kcMax;
+            if (packedA.size() < sizeA)
+                packedA.resize(sizeA);
+            if (packedB.size() < sizeB)
+                packedB.resize(sizeB);
+
+            for (size_t jc = 0; jc < n; jc += Blocking::NC)
+            {
+                const size_t nc = std::min(Blocking::NC, n - jc);
+                for (size_t pc = 0; pc < k; pc += Blocking::KC)
+                {
+                    const size_t kc = std::min(Blocking::KC, k - pc);
+                    PackB(kc, nc, StridedRef<const _Ty>{&b(pc, jc), b.rowStride, b.colStride}, packedB.data());
+                    // rows past the last column of this block only meet tiles below the diagonal
+                    const size_t rowEnd = _Upper ? std::min(m, jc + nc) : m;
+                    for (size_t ic = 0; ic < rowEnd; ic += Blocking::MC)
+                    {
+                        const size_t mc = std::min(Blocking::MC, rowEnd - ic);
+                        PackA(mc, kc, StridedRef<const _Ty>{&a(ic, pc), a.rowStride, a.colStride}, packedA.data());
+                        for (size_t jr = 0; jr < nc; jr += Blocking::NR)
+                        {
+                            const size_t nr = std::min(Blocking::NR, nc - jr);
+                            size_t rows = mc;
+                            if constexpr (_Upper)
+                                rows = jc + jr + nr > ic ? std::min(mc, jc + jr + nr - ic) : 0;
+                            for (size_t ir = 0; ir < rows; ir += Blocking::MR)
+                            {
+                                const size_t mr = std::min(Blocking::MR, mc - ir);
+                                MicroKernel(kc, mr, nr, alpha,
+                                            packedA.data() + ir * kc, packedB.data() + jr * kc,
+                                            StridedRef<_Ty>{&c(ic + ir, jc + jr), c.rowStride, c.colStride});
+                            }
+                        }
+                    }
+                }
+            }
+        }
+#pragma endregion
+
+        /// @brief General matrix product C = alpha * A * B + beta * C
+        /// @tparam _Ty Element Type
+        /// @param m Rows of A and C
+        /// @param n Columns of B and C
+        /// @param k Columns of A and rows of B
+        /// @param a Left operand, any strides (a transposed view is just swapped strides)
+        /// @param b Right operand, any strides
+        /// @param c Destination, must not alias A or B
+        template <typename _Ty>
+        void Gemm(size_t m, size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, _Ty beta, StridedRef<_Ty> c)
+        {
+            using Blocking = GemmBlocking<_Ty>;
+            ScaleTile(m, n, beta, c);
+            if (m == 0 || n == 0 || k == 0 || alpha == _Ty(0))
+                return;
+            if (n == 1)
+            {
+                Gemv(m, k, alpha, a, b, c);
+                return;
+            }
+            const bool unitRows = b.colStride == 1 && c.colStride == 1;
+            if (m * n * k <= (unitRows ? Blocking::SmallWork : Blocking::SmallStridedWork))
+            {
+                GemmSmall(m, n, k, alpha, a, b, c);
+                return;
+            }
+            GemmPacked<_Ty, false>(m, n, k, alpha, a, b, c);
+        }
+
+        /// @brief The upper triangle of the n x n product C = alpha * A * B + beta * C. Register tiles wholly below
+        /// the diagonal are skipped and every panel is still packed once, so it costs about half a full product.
+        /// @param k Columns of A and rows of B
+        /// @param c Destination, must not alias A or B. Entries below the diagonal inside register tiles
+        /// that cross it are written too
+        template <typename _Ty>
+        void GemmUpper(size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, _Ty beta, StridedRef<_Ty> c)
+        {
+            using Blocking = GemmBlocking<_Ty>;
+            ScaleTile(n, n, beta, c);
+            if (n == 0 || k == 0 || alpha == _Ty(0))
+                return;
+            const bool unitRows = b.colStride == 1 && c.colStride == 1;
+            if (n * n * k <= (unitRows ? Blocking::SmallWork : Blocking::SmallStridedWork))
+            {
+                for (size_t i = 0; i < n; ++i)
+                    GemmSmall(1, n - i, k, alpha, a.Block(i, 0), b.Block(0, i), c.Block(i, i));
+                return;
+            }
+            GemmPacked<_Ty, true>(n, n, k, alpha, a, b, c);
+        }
+
+#pragma region "Accumulating Gemm"
+        /// @brief C = alpha * A * B + beta * C with the running sums in double. The operands are widened once,
+        /// multiplied by the double GEMM, and every element of C is rounded once at the end.
+        template <typename _Ty>
+        void GemmDouble(size_t m, size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, _Ty beta, StridedRef<_Ty> c)
+        {
+            if constexpr (sizeof(_Ty) >= sizeof(double))
+                Gemm<_Ty>(m, n, k, alpha, a, b, beta, c);
+            else
+            {
+                memory::ArenaScope scope;
+                std::vector<double, memory::ArenaAllocator<double>> wa(m * k), wb(k * n), wc(m * n);
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t p = 0; p < k; ++p)
+                        wa[i * k + p] = a(i, p);
+                for (size_t p = 0; p < k; ++p)
+                    for (size_t j = 0; j < n; ++j)
+                        wb[p * n + j] = b(p, j);
+                Gemm<double>(m, n, k, 1.0, {wa.data(), k, 1}, {wb.data(), n, 1}, 0.0, {wc.data(), n, 1});
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        const double scaled = beta == _Ty(0) ? 0.0 : double(beta) * double(c(i, j));
+                        c(i, j) = static_cast<_Ty>(double(alpha) * wc[i * n + j] + scaled);
+                    }
+            }
+        }
+
+        /// @brief C = alpha * A * B + beta * C, every dot product summed with Kahan's compensation in the element type.
+        /// The unpacked i-p-j order of GemmSmall with a row of sums and a row of carries, three more adds per term.
+        template <typename _Ty>
+        void GemmKahan(size_t m, size_t n, size_t k, _Ty alpha, StridedRef<const _Ty> a, StridedRef<const _Ty> b, _Ty beta, StridedRef<_Ty> c)
+        {
+            ScaleTile(m, n, beta, c);
+            if (m == 0 || n == 0 || k == 0 || alpha == _Ty(0))
+                return;
+            memory::ArenaScope scope;
+            std::vector<_Ty, memory::ArenaAllocator<_Ty>> sum(n), carry(n);
+            for (size_t i = 0; i < m; ++i)
+            {
+                std::fill(sum.begin(), sum.end(), _Ty(0));
+                std::fill(carry.begin(), carry.end(), _Ty(0));
+                for (size_t p = 0; p < k; ++p)
+                {
+                    const _Ty aip = a(i, p);
+                    const auto step = [&](size_t j, _Ty bpj)
+                    {
+                        const _Ty y = aip * bpj - carry[j];
+                        const _Ty t = sum[j] + y;
+                        carry[j] = (t - sum[j]) - y;
+                        sum[j] = t;
+                    };
+                    // a unit-stride row of B lets the compiler vectorize the compensated update
+                    if (b.colStride == 1)
+                    {
+                        const _Ty *row = &b(p, 0);
+                        for (size_t j = 0; j < n; ++j)
+                            step(j, row[j]);
+                    }
+                    else
+                        for (size_t j = 0; j < n; ++j)
+                            step(j, b(p, j));
+                }
+                for (size_t j = 0; j < n; ++j)
+                    c(i, j) += alpha * sum[j];
+            }
+        }
+#pragma endregion
+
+#pragma region "Strided copy"
+        /// @brief Edge of the square tiles used by the transposing copies, 32 x 32 doubles stay well inside L1
+        constexpr size_t TransposeTile = 32;
+
+        /// @brief dst = src for any strides. A transposing copy walks one of the two operands across rows,
+        /// so both are traversed tile by tile and every touched cache line is reused before it is evicted.
+        template <typename _Ty>
+        constexpr void CopyTiled(size_t rows, size_t cols, StridedRef<const _Ty> src, StridedRef<_Ty> dst)
+        {
+            for (size_t i0 = 0; i0 < rows; i0 += TransposeTile)
+            {
+                const size_t iEnd = std::min(i0 + TransposeTile, rows);
+                for (size_t j0 = 0; j0 < cols; j0 += TransposeTile)
+                {
+                    const size_t jEnd = std::min(j0 + TransposeTile, cols);
+                    for (size_t i = i0; i < iEnd; ++i)
+                        for (size_t j = j0; j < jEnd; ++j)
+                            dst(i, j) = src(i, j);
+                }
+            }
+        }
+
+        /// @brief Edge of the tile pairs buffered by the in-place transpose, both buffers and both tiles share L1
+        constexpr size_t TransposeSwapTile = 16;
+
+        /// @brief Transpose a n x n row-major matrix in place by swapping tile (i, j) with tile (j, i).
+        /// Both tiles are read row by row into local buffers and written back transposed, so the matrix is only
+        /// walked along rows; swapping in place would walk columns a row apart, and with a power-of-two n those
+        /// lines all share a few L1 sets and evict each other.
+        template <typename _Ty>
+        constexpr void TransposeSquare(size_t n, _Ty *data)
+        {
+            _Ty upper[TransposeSwapTile * TransposeSwapTile], lower[TransposeSwapTile * TransposeSwapTile];
+            // full tiles get constant trip counts, which the vectorizer needs for the transposed reads
+            const auto load = [&](size_t i0, size_t j0, size_t rows, size_t cols, _Ty *tile)
+            {
+                const _Ty *src = data + i0 * n + j0;
+                if (rows == TransposeSwapTile && cols == TransposeSwapTile)
+                    for (size_t i = 0; i < TransposeSwapTile; ++i)
+                        for (size_t j = 0; j < TransposeSwapTile; ++j)
+                            tile[i * TransposeSwapTile + j] = src[i * n + j];
+                else
+                    for (size_t i = 0; i < rows; ++i)
+                        for (size_t j = 0; j < cols; ++j)
+                            tile[i * TransposeSwapTile + j] = src[i * n + j];
+            };
+            // writes the rows x cols tile at (i0, j0) from the transposed cols x rows tile
+            const auto store = [&](size_t i0, size_t j0, size_t rows, size_t cols, const _Ty *tile)
+            {
+                _Ty *dst = data + i0 * n + j0;
+                if (rows == TransposeSwapTile && cols == TransposeSwapTile)
+                    for (size_t i = 0; i < TransposeSwapTile; ++i)
+                        for (size_t j = 0; j < TransposeSwapTile; ++j)
+                            dst[i * n + j] = tile[j * TransposeSwapTile + i];
+                else
+                    for (size_t i = 0; i < rows; ++i)
+                        for (size_t j = 0; j < cols; ++j)
+                            dst[i * n + j] = tile[j * TransposeSwapTile + i];
+            };
+            for (size_t i0 = 0; i0 < n; i0 += TransposeSwapTile)
+            {
+                const size_t ib = std::min(TransposeSwapTile, n - i0);
+                load(i0, i0, ib, ib, upper);
+                store(i0, i0, ib, ib, upper);
+                for (size_t j0 = i0 + TransposeSwapTile; j0 < n; j0 += TransposeSwapTile)
+                {
+                    const size_t jb = std::min(TransposeSwapTile, n - j0);
+                    load(i0, j0, ib, jb, upper);
+                    load(j0, i0, jb, ib, lower);
+                    store(i0, j0, ib, jb, lower);
+                    store(j0, i0, jb, ib, upper);
+                }
+            }
+        }
+#pragma endregion
+    }
+}
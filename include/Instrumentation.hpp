@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Define LINERALGEBRA_INSTRUMENT before including any header of the library to count matrix constructions,
+// copies, moves, heap allocations and expression evaluations. Without it every hook below is an empty inline
+// function, Tracked is an empty base and the storage keeps its own allocator, so nothing is left in the build.
+
+namespace LinerAlgebra
+{
+    namespace instrument
+    {
+#if defined(LINERALGEBRA_INSTRUMENT)
+        constexpr bool Enabled = true;
+#else
+        constexpr bool Enabled = false;
+#endif
+
+#pragma region "Counters"
+        /// @brief Snapshot of matrix and expression activity
+        struct Stats
+        {
+            size_t constructions; // matrices built from nothing or a shape
+            size_t copies;        // copy constructions and copy assignments
+            size_t moves;         // move constructions and move assignments
+            size_t allocations;   // heap blocks requested by matrix storage
+            size_t bytes;
+            size_t evaluations; // expression trees evaluated into storage
+            size_t temporaries; // evaluations into storage the caller never sees
+            size_t elements;    // elements written by all evaluations
+
+            constexpr Stats operator-(const Stats &other) const noexcept
+            {
+                return {constructions - other.constructions, copies - other.copies, moves - other.moves,
+                        allocations - other.allocations, bytes - other.bytes, evaluations - other.evaluations,
+                        temporaries - other.temporaries, elements - other.elements};
+            }
+        };
+
+        /// @brief Evaluations of one expression type
+        struct ExprStats
+        {
+            std::string_view name;
+            size_t evaluations;
+            size_t temporaries;
+            size_t elements;
+        };
+
+        namespace detail
+        {
+            struct Counters
+            {
+                std::atomic<size_t> constructions{0};
+                std::atomic<size_t> copies{0};
+                std::atomic<size_t> moves{0};
+                std::atomic<size_t> allocations{0};
+                std::atomic<size_t> bytes{0};
+                std::atomic<size_t> evaluations{0};
+                std::atomic<size_t> temporaries{0};
+                std::atomic<size_t> elements{0};
+            };
+            inline Counters &GlobalCounters()
+            {
+                static Counters counters;
+                return counters;
+            }
+
+            struct ExprCounters
+            {
+                std::string_view name;
+                std::atomic<size_t> evaluations{0};
+                std::atomic<size_t> temporaries{0};
+                std::atomic<size_t> elements{0};
+            };
+            /// @brief Counters of every expression type evaluated so far, in order of first evaluation
+            struct ExprRegistry
+            {
+                std::mutex mutex;
+                std::vector<ExprCounters *> types;
+            };
+            inline ExprRegistry &GlobalRegistry()
+            {
+                static ExprRegistry registry;
+                return registry;
+            }
+
+            /// @brief Readable name of _Ty cut out of the signature of this function
+            template <typename _Ty>
+            constexpr std::string_view TypeName()
+            {
+#if defined(_MSC_VER) && !defined(__clang__)
+                std::string_view name = __FUNCSIG__;
+                const size_t begin = name.find("TypeName<") + 9;
+                const size_t end = name.rfind(">(void)");
+#else
+                std::string_view name = __PRETTY_FUNCTION__;
+                const size_t begin = name.find("_Ty = ") + 6;
+                const size_t end = name.find_first_of(";]", begin);
+#endif
+                return name.substr(begin, end - begin);
+            }
+
+            template <typename _Expr>
+            ExprCounters &TypeCounters()
+            {
+                static ExprCounters &counters = []() -> ExprCounters &
+                {
+                    // never freed, the registry hands out pointers for the lifetime of the program
+                    auto *created = new ExprCounters{TypeName<_Expr>()};
+                    ExprRegistry &registry = GlobalRegistry();
+                    std::lock_guard lock(registry.mutex);
+                    registry.types.push_back(created);
+                    return *created;
+                }();
+                return counters;
+            }
+
+            inline void Add(std::atomic<size_t> &counter, size_t value = 1) noexcept
+            {
+                counter.fetch_add(value, std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief Totals since start or the last ResetStats()
+        inline Stats GetStats()
+        {
+            detail::Counters &counters = detail::GlobalCounters();
+            return {counters.constructions.load(std::memory_order_relaxed),
+                    counters.copies.load(std::memory_order_relaxed),
+                    counters.moves.load(std::memory_order_relaxed),
+                    counters.allocations.load(std::memory_order_relaxed),
+                    counters.bytes.load(std::memory_order_relaxed),
+                    counters.evaluations.load(std::memory_order_relaxed),
+                    counters.temporaries.load(std::memory_order_relaxed),
+                    counters.elements.load(std::memory_order_relaxed)};
+        }
+        /// @brief Per expression type counts since start or the last ResetStats()
+        inline std::vector<ExprStats> GetExprStats()
+        {
+            detail::ExprRegistry &registry = detail::GlobalRegistry();
+            std::lock_guard lock(registry.mutex);
+            std::vector<ExprStats> res;
+            res.reserve(registry.types.size());
+            for (const detail::ExprCounters *counters : registry.types)
+                res.push_back({counters->name, counters->evaluations.load(std::memory_order_relaxed),
+                               counters->temporaries.load(std::memory_order_relaxed),
+                               counters->elements.load(std::memory_order_relaxed)});
+            return res;
+        }
+        inline void ResetStats()
+        {
+            detail::Counters &counters = detail::GlobalCounters();
+            for (auto *counter : {&counters.constructions, &counters.copies, &counters.moves, &counters.allocations,
+                                  &counters.bytes, &counters.evaluations, &counters.temporaries, &counters.elements})
+                counter->store(0, std::memory_order_relaxed);
+            detail::ExprRegistry &registry = detail::GlobalRegistry();
+            std::lock_guard lock(registry.mutex);
+            for (detail::ExprCounters *type : registry.types)
+            {
+                type->evaluations.store(0, std::memory_order_relaxed);
+                type->temporaries.store(0, std::memory_order_relaxed);
+                type->elements.store(0, std::memory_order_relaxed);
+            }
+        }
+#pragma endregion
+
+#pragma region "Hooks"
+        /// @brief An expression tree was evaluated into storage, a matrix or view of the caller or a temporary
+        template <typename _Expr>
+        constexpr void RecordEvaluation([[maybe_unused]] size_t elements)
+        {
+            if constexpr (Enabled)
+            {
+                if (std::is_constant_evaluated())
+                    return;
+                detail::Counters &counters = detail::GlobalCounters();
+                detail::Add(counters.evaluations);
+                detail::Add(counters.elements, elements);
+                detail::ExprCounters &type = detail::TypeCounters<_Expr>();
+                detail::Add(type.evaluations);
+                detail::Add(type.elements, elements);
+            }
+        }
+        /// @brief The evaluation of _Expr went into storage the caller never sees:
+        /// an aliasing-safe copy, a materialized product operand or a product cache
+        template <typename _Expr>
+        constexpr void RecordTemporary()
+        {
+            if constexpr (Enabled)
+            {
+                if (std::is_constant_evaluated())
+                    return;
+                detail::Add(detail::GlobalCounters().temporaries);
+                detail::Add(detail::TypeCounters<_Expr>().temporaries);
+            }
+        }
+
+#if defined(LINERALGEBRA_INSTRUMENT)
+        /// @brief Empty base of matrix storage counting how matrices come to life
+        struct Tracked
+        {
+            constexpr Tracked() noexcept { Record(&detail::Counters::constructions); }
+            constexpr Tracked(const Tracked &) noexcept { Record(&detail::Counters::copies); }
+            constexpr Tracked(Tracked &&) noexcept { Record(&detail::Counters::moves); }
+            constexpr Tracked &operator=(const Tracked &) noexcept
+            {
+                Record(&detail::Counters::copies);
+                return *this;
+            }
+            constexpr Tracked &operator=(Tracked &&) noexcept
+            {
+                Record(&detail::Counters::moves);
+                return *this;
+            }
+
+        private:
+            static constexpr void Record(std::atomic<size_t> detail::Counters::*counter) noexcept
+            {
+                if (!std::is_constant_evaluated())
+                    detail::Add(detail::GlobalCounters().*counter);
+            }
+        };
+
+        /// @brief _Alloc counting every block it hands out
+        template <typename _Alloc>
+        struct TrackedAllocator : _Alloc
+        {
+            using value_type = typename std::allocator_traits<_Alloc>::value_type;
+            template <typename _Other>
+            struct rebind
+            {
+                using other = TrackedAllocator<typename std::allocator_traits<_Alloc>::template rebind_alloc<_Other>>;
+            };
+
+            TrackedAllocator() noexcept = default;
+            template <typename _Other>
+            TrackedAllocator(const TrackedAllocator<_Other> &other) noexcept : _Alloc(static_cast<const _Other &>(other)) {}
+
+            value_type *allocate(size_t count)
+            {
+                detail::Counters &counters = detail::GlobalCounters();
+                detail::Add(counters.allocations);
+                detail::Add(counters.bytes, count * sizeof(value_type));
+                return std::allocator_traits<_Alloc>::allocate(*this, count);
+            }
+            void deallocate(value_type *ptr, size_t count) noexcept { std::allocator_traits<_Alloc>::deallocate(*this, ptr, count); }
+        };
+        template <typename _Alloc>
+        using StorageAllocator = TrackedAllocator<_Alloc>;
+#else
+        struct Tracked
+        {
+        };
+        template <typename _Alloc>
+        using StorageAllocator = _Alloc;
+#endif
+#pragma endregion
+
+#pragma region "Profiler"
+        /// @brief Counts everything that happens between construction and Stats(), e.g.
+        /// instrument::Profiler profiler; Step(filter); assert(profiler.Stats().temporaries == 0);
+        /// Counters are shared by all threads, so work on other threads inside the scope is counted too.
+        class Profiler
+        {
+            instrument::Stats start;
+            std::vector<instrument::ExprStats> startTypes;
+
+        public:
+            Profiler() : start(GetStats()), startTypes(GetExprStats()) {}
+            Profiler(const Profiler &) = delete;
+            Profiler &operator=(const Profiler &) = delete;
+
+            /// @brief Totals since construction
+            instrument::Stats Stats() const { return GetStats() - start; }
+            /// @brief Expression types evaluated since construction
+            std::vector<instrument::ExprStats> ExprStats() const
+            {
+                std::vector<instrument::ExprStats> res;
+                const std::vector<instrument::ExprStats> now = GetExprStats();
+                for (size_t index = 0; index < now.size(); ++index)
+                {
+                    instrument::ExprStats type = now[index];
+                    // the registry only grows, so types seen at construction keep their position
+                    if (index < startTypes.size())
+                    {
+                        type.evaluations -= startTypes[index].evaluations;
+                        type.temporaries -= startTypes[index].temporaries;
+                        type.elements -= startTypes[index].elements;
+                    }
+                    if (type.evaluations != 0 || type.temporaries != 0)
+                        res.push_back(type);
+                }
+                return res;
+            }
+            /// @brief Totals, then one line per expression type with temporaries first
+            void Report(std::ostream &os) const
+            {
+                if constexpr (!Enabled)
+                {
+                    os << "instrumentation disabled, define LINERALGEBRA_INSTRUMENT\n";
+                    return;
+                }
+                const instrument::Stats stats = Stats();
+                os << "constructions " << stats.constructions << ", copies " << stats.copies << ", moves " << stats.moves
+                   << ", allocations " << stats.allocations << " (" << stats.bytes << " bytes), evaluations "
+                   << stats.evaluations << ", temporaries " << stats.temporaries << ", elements " << stats.elements << '\n';
+                std::vector<instrument::ExprStats> types = ExprStats();
+                std::stable_sort(types.begin(), types.end(), [](const auto &x, const auto &y)
+                                 { return x.temporaries > y.temporaries; });
+                for (const instrument::ExprStats &type : types)
+                    os << "  " << type.temporaries << " temporaries, " << type.evaluations << " evaluations, "
+                       << type.elements << " elements: " << type.name << '\n';
+            }
+        };
+#pragma endregion
+    }
+}
@@ -1,85 +1,829 @@
 #pragma once
 
 #include <concepts>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include "Allocator.hpp"
 #include "Error.hpp"
+#include "Instrumentation.hpp"
+#include "Gemm.hpp"
+#include "FixedKernel.hpp"
+#include "Simd.hpp"
+#include "Parallel.hpp"
 
 namespace LinerAlgebra
 {
+    constexpr size_t Dynamic = 0;
+
+    /// @brief Precision of the running sums inside reductions and products
+    enum class Accumulation
+    {
+        /// @brief In the element type
+        Native,
+        /// @brief In double, float elements are summed without rounding every partial sum to float
+        Double,
+        /// @brief In the element type with Kahan's compensation carried alongside every running sum
+        Kahan
+    };
+
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    class Matrix;
+
+    template <typename _Mat>
+    class NoAliasProxy;
+
     namespace lazy
     {
         template <typename _Ty>
         concept arithmetic = std::is_arithmetic_v<_Ty>;
 
+        /// @brief Type a scalar operand takes next to elements of _Elem: floating elements keep their precision,
+        /// so a float matrix times 0.5 stays a float expression, anything else promotes as the language does
+        template <typename _Elem, typename _Num>
+        using ScalarType = std::conditional_t<std::is_floating_point_v<_Elem>, _Elem, std::common_type_t<_Elem, _Num>>;
+
         constexpr size_t Max(size_t x, size_t y)
         {
             return x < y ? y : x;
         }
 
+#pragma region "Compile-time shape"
+        /// @brief Compile-time extent of a scalar operand, it matches any size
+        constexpr size_t Broadcast = static_cast<size_t>(-1);
+
+        constexpr bool IsFixed(size_t dim)
+        {
+            return dim != Dynamic && dim != Broadcast;
+        }
+
+        /// @brief Whether two compile-time extents can describe the same runtime extent
+        constexpr bool DimMatch(size_t x, size_t y)
+        {
+            return !IsFixed(x) || !IsFixed(y) || x == y;
+        }
+
+        /// @brief Compile-time extent of an elementwise result, fixed wins over Dynamic
+        constexpr size_t DimCombine(size_t x, size_t y)
+        {
+            if (x == Broadcast)
+                return y;
+            if (y == Broadcast || x == Dynamic)
+                return IsFixed(y) ? y : x;
+            return x;
+        }
+
+        /// @brief Runtime extent, folded to a constant when it is known at compile time
+        template <size_t _Dim>
+        constexpr size_t Extent(size_t runtime)
+        {
+            if constexpr (IsFixed(_Dim))
+                return _Dim;
+            else
+                return runtime;
+        }
+
+        /// @brief Elementwise shape check: a compile error for fixed operands, SizeExcept otherwise
+        template <typename _LHS, typename _RHS>
+        constexpr void CheckSameSize(const _LHS &lhs, const _RHS &rhs)
+        {
+            static_assert(DimMatch(_LHS::RowsAtCompileTime, _RHS::RowsAtCompileTime) &&
+                              DimMatch(_LHS::ColsAtCompileTime, _RHS::ColsAtCompileTime),
+                          "Matrices' size mismatch!");
+            if constexpr (!(IsFixed(_LHS::RowsAtCompileTime) && IsFixed(_RHS::RowsAtCompileTime) &&
+                            IsFixed(_LHS::ColsAtCompileTime) && IsFixed(_RHS::ColsAtCompileTime)))
+            {
+                if (lhs.Row() != rhs.Row() || lhs.Col() != rhs.Col())
+                    throw SizeExcept();
+            }
+        }
+
+        /// @brief Inner dimension check of lhs * rhs: a compile error for fixed operands, SizeExcept otherwise
+        template <typename _LHS, typename _RHS>
+        constexpr void CheckProductSize(const _LHS &lhs, const _RHS &rhs)
+        {
+            static_assert(DimMatch(_LHS::ColsAtCompileTime, _RHS::RowsAtCompileTime), "Matrices' size mismatch!");
+            if constexpr (!(IsFixed(_LHS::ColsAtCompileTime) && IsFixed(_RHS::RowsAtCompileTime)))
+            {
+                if (lhs.Col() != rhs.Row())
+                    throw SizeExcept();
+            }
+        }
+#pragma endregion
+
 #pragma region "Binary functor"
         struct AddOperatorType
         {
+            static constexpr size_t Cost = 1;
             constexpr explicit AddOperatorType() = default;
             template <typename LHS, typename RHS>
-            auto operator()(const LHS &lhs, const RHS &rhs) const
+            constexpr auto operator()(const LHS &lhs, const RHS &rhs) const
             {
                 return lhs + rhs;
             }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const
+            {
+                return simd::Add(lhs, rhs);
+            }
         };
         constexpr AddOperatorType addOpt{};
 
         struct SubtractOperatorType
         {
+            static constexpr size_t Cost = 1;
             constexpr explicit SubtractOperatorType() = default;
             template <typename LHS, typename RHS>
-            auto operator()(const LHS &lhs, const RHS &rhs) const
+            constexpr auto operator()(const LHS &lhs, const RHS &rhs) const
             {
                 return lhs - rhs;
             }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const
+            {
+                return simd::Sub(lhs, rhs);
+            }
         };
         constexpr SubtractOperatorType subOpt{};
 
         struct MultipleOperatorType
         {
+            static constexpr size_t Cost = 1;
             constexpr explicit MultipleOperatorType() = default;
             template <typename LHS, typename RHS>
-            auto operator()(const LHS &lhs, const RHS &rhs) const
+            constexpr auto operator()(const LHS &lhs, const RHS &rhs) const
             {
                 return lhs * rhs;
             }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const
+            {
+                return simd::Mul(lhs, rhs);
+            }
         };
         constexpr MultipleOperatorType mulOpt{};
 
         struct DivideOperatorType
         {
+            // a divide takes several times the throughput of an add or multiply
+            static constexpr size_t Cost = 4;
             constexpr explicit DivideOperatorType() = default;
             template <typename LHS, typename RHS>
-            auto operator()(const LHS &lhs, const RHS &rhs) const
+            constexpr auto operator()(const LHS &lhs, const RHS &rhs) const
             {
                 return lhs / rhs;
             }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const
+            {
+                return simd::Div(lhs, rhs);
+            }
         };
         constexpr DivideOperatorType divOpt{};
 #pragma endregion
 
+#pragma region "Reduction functor"
+        /// @brief acc + x
+        struct SumReduction
+        {
+            template <typename _Ty>
+            constexpr _Ty operator()(const _Ty &acc, const _Ty &x) const { return acc + x; }
+            template <typename _Ty>
+            constexpr _Ty Combine(const _Ty &lhs, const _Ty &rhs) const { return lhs + rhs; }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &acc, const simd::Packet<_Ty> &x) const { return simd::Add(acc, x); }
+            template <typename _Ty>
+            simd::Packet<_Ty> Combine(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const { return simd::Add(lhs, rhs); }
+            template <typename _Ty>
+            _Ty Horizontal(const simd::Packet<_Ty> &acc) const { return simd::ReduceAdd(acc); }
+        };
+
+        /// @brief acc + x²
+        struct SquaredNormReduction
+        {
+            template <typename _Ty>
+            constexpr _Ty operator()(const _Ty &acc, const _Ty &x) const { return acc + x * x; }
+            template <typename _Ty>
+            constexpr _Ty Combine(const _Ty &lhs, const _Ty &rhs) const { return lhs + rhs; }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &acc, const simd::Packet<_Ty> &x) const { return simd::Add(acc, simd::Mul(x, x)); }
+            template <typename _Ty>
+            simd::Packet<_Ty> Combine(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const { return simd::Add(lhs, rhs); }
+            template <typename _Ty>
+            _Ty Horizontal(const simd::Packet<_Ty> &acc) const { return simd::ReduceAdd(acc); }
+        };
+
+        /// @brief max(acc, |x|)
+        struct MaxAbsReduction
+        {
+            template <typename _Ty>
+            constexpr _Ty operator()(const _Ty &acc, const _Ty &x) const { return Combine(acc, kernel::Abs(x)); }
+            template <typename _Ty>
+            constexpr _Ty Combine(const _Ty &lhs, const _Ty &rhs) const { return lhs < rhs ? rhs : lhs; }
+            template <typename _Ty>
+            simd::Packet<_Ty> Packet(const simd::Packet<_Ty> &acc, const simd::Packet<_Ty> &x) const { return simd::Max(acc, simd::Abs(x)); }
+            template <typename _Ty>
+            simd::Packet<_Ty> Combine(const simd::Packet<_Ty> &lhs, const simd::Packet<_Ty> &rhs) const { return simd::Max(lhs, rhs); }
+            template <typename _Ty>
+            _Ty Horizontal(const simd::Packet<_Ty> &acc) const { return simd::ReduceMax(acc); }
+        };
+#pragma endregion
+
+
+        template <typename _Derived>
+        class Expr;
+
+        template <typename _Ty>
+        concept expression = std::derived_from<_Ty, Expr<_Ty>>;
+
+        /// @brief Storage (not an expression) whose elements can be read at a row-major index
+        template <typename _Ty>
+        concept leaf = !expression<_Ty> && requires(const _Ty &mat, size_t index) {
+            _Ty::RowsAtCompileTime;
+            _Ty::ColsAtCompileTime;
+            _Ty::IsInStack();
+            mat.Row();
+            mat.Col();
+            mat[index];
+        };
+
+        /// @brief Dense leaf whose row-major elements can be read in place
+        template <typename _Ty>
+        concept matrix = leaf<_Ty> && requires(const _Ty &mat) {
+            mat.Data();
+        };
+
+        template <arithmetic _Ty>
+        struct ExprScalar;
+
+        template <typename _Ty>
+        class ExprStart;
+
+        template <typename _BiFunc, typename _LExpr, typename _RExpr>
+        class BinaryOperator;
+
+        template <typename _LExpr, typename _RExpr, Accumulation _Acc = Accumulation::Native>
+        class ProductExpr;
+
+        template <typename _Expr>
+        class TransposeExpr;
+
+        template <typename _Ty, size_t _Rows, size_t _Cols>
+        class View;
+
+        /// @brief Node that can produce a whole simd::Packet of _Ty at a flat index
+        template <typename _Expr, typename _Ty>
+        concept packetable = requires(const _Expr &expr, size_t index) {
+            { expr.template Packet<_Ty>(index) } -> std::same_as<simd::Packet<_Ty>>;
+        };
+
+        /// @brief Storage exposing contiguous row-major elements of type _Ty
+        template <typename _Mat, typename _Ty>
+        concept contiguous = requires(const _Mat &mat) {
+            { mat.Data() } -> std::same_as<const _Ty *>;
+        };
+
+        /// @brief Float storage read as double packets, where a float operand meets a double one
+        template <typename _Mat, typename _Ty>
+        concept widenable = std::same_as<_Ty, double> && contiguous<_Mat, float>;
+
+        /// @brief Element type produced by an expression node
+        template <typename _Expr>
+        using ExprValueType = std::remove_cvref_t<decltype(std::declval<const _Expr &>().At(0))>;
+
+        /// @brief Work of evaluating n elements of an expression, at least n. Every node declares a Cost:
+        /// the arithmetic behind one element once Prepare() has run, 0 for storage and cached results.
+        template <typename _Expr>
+        constexpr size_t Work(size_t n) { return n * Max(_Expr::Cost, 1); }
+
+        /// @brief Scratch storage of one evaluation, served by the thread-local arena inside a memory::ArenaScope
+        template <typename _Ty>
+        using ScratchBuffer = std::vector<_Ty, memory::ArenaAllocator<_Ty>>;
+
+        /// @brief Result of a node computed once and read element by element, kept in the thread-local arena.
+        /// It empties itself when the arena scope it was filled in ends, and a copy of the node starts empty.
+        template <typename _Ty>
+        class ResultCache
+        {
+            memory::ArenaBlock block;
+            size_t count = 0;
+
+        public:
+            ResultCache() = default;
+            ResultCache(const ResultCache &) noexcept {}
+            ResultCache &operator=(const ResultCache &) noexcept
+            {
+                block.Release();
+                return *this;
+            }
+
+            bool IsFilled() const noexcept { return block.Data() != nullptr; }
+            /// @brief Storage for size elements, the previous result is given back
+            _Ty *Allocate(size_t size)
+            {
+                count = size;
+                return static_cast<_Ty *>(block.Acquire(size * sizeof(_Ty)));
+            }
+            const _Ty *data() const noexcept { return static_cast<const _Ty *>(block.Data()); }
+            size_t size() const noexcept { return count; }
+            const _Ty &operator[](size_t index) const noexcept { return data()[index]; }
+        };
+
+        /// @brief Trees that may fill a ResultCache while they are evaluated
+        template <typename _Expr>
+        concept caching = requires { requires _Expr::HoldsCache; };
+
+        struct NoScope
+        {
+        };
+        /// @brief Arena scope around the evaluation of a tree, so caches filled on the way are given back once it is written.
+        /// Trees without caches skip it.
+        template <typename _Expr>
+        using EvaluationScope = std::conditional_t<caching<_Expr>, memory::ArenaScope, NoScope>;
+
+#pragma region "Reduction"
+        /// @brief Elements folded by one task of a parallel reduction. The split depends only on the size,
+        /// so the result is the same whatever the number of threads.
+        constexpr size_t ReduceGrain = size_t(1) << 14;
+
+        /// @brief Type of the running sums of a reduction of _Expr
+        template <typename _Expr, Accumulation _Acc>
+        using AccumulatorType = std::conditional_t<_Acc == Accumulation::Double,
+                                                   std::common_type_t<ExprValueType<_Expr>, double>, ExprValueType<_Expr>>;
+
+        /// @brief Running sum with Kahan's compensation: the low-order bits an add rounds away are
+        /// subtracted from the next term instead of being lost
+        template <typename _Ty>
+        struct KahanSum
+        {
+            _Ty sum{0};
+            _Ty carry{0};
+
+            constexpr void Add(_Ty x)
+            {
+                const _Ty y = x - carry;
+                const _Ty t = sum + y;
+                carry = (t - sum) - y;
+                sum = t;
+            }
+            /// @brief Fold in every lane of packet accumulators, each with its own carry
+            void Add(const simd::Packet<_Ty> &sums, const simd::Packet<_Ty> &carries)
+            {
+                constexpr size_t width = simd::Packet<_Ty>::Size;
+                _Ty s[width], c[width];
+                simd::Store(s, sums);
+                simd::Store(c, carries);
+                for (size_t lane = 0; lane < width; ++lane)
+                {
+                    Add(s[lane]);
+                    Add(-c[lane]);
+                }
+            }
+        };
+
+        /// @brief One compensated step of packet accumulators, lane by lane the scalar KahanSum::Add
+        template <typename _Ty>
+        void KahanStep(simd::Packet<_Ty> &sum, simd::Packet<_Ty> &carry, const simd::Packet<_Ty> &x)
+        {
+            const simd::Packet<_Ty> y = simd::Sub(x, carry);
+            const simd::Packet<_Ty> t = simd::Add(sum, y);
+            carry = simd::Sub(simd::Sub(t, sum), y);
+            sum = t;
+        }
+
+        /// @brief Compensated fold of elements [begin, end) of expr for an additive op, whose term is op(0, x)
+        template <typename _Expr, typename _Op>
+        ExprValueType<_Expr> ReduceKahan(const _Expr &expr, const _Op &op, size_t begin, size_t end)
+        {
+            using ValueType = ExprValueType<_Expr>;
+            KahanSum<ValueType> acc;
+            size_t index = begin;
+            if constexpr (packetable<_Expr, ValueType>)
+            {
+                constexpr size_t width = simd::Packet<ValueType>::Size;
+                if (index + width <= end)
+                {
+                    const simd::Packet<ValueType> zero = simd::Set1(ValueType(0));
+                    simd::Packet<ValueType> sum0 = zero, sum1 = zero, carry0 = zero, carry1 = zero;
+                    for (; index + 2 * width <= end; index += 2 * width)
+                    {
+                        KahanStep(sum0, carry0, op.Packet(zero, expr.template Packet<ValueType>(index)));
+                        KahanStep(sum1, carry1, op.Packet(zero, expr.template Packet<ValueType>(index + width)));
+                    }
+                    for (; index + width <= end; index += width)
+                        KahanStep(sum0, carry0, op.Packet(zero, expr.template Packet<ValueType>(index)));
+                    acc.Add(sum0, carry0);
+                    acc.Add(sum1, carry1);
+                }
+            }
+            for (; index < end; ++index)
+                acc.Add(op(ValueType(0), static_cast<ValueType>(expr.At(index))));
+            return acc.sum;
+        }
+
+        /// @brief Fold elements [begin, end) of expr, four packet accumulators hide the latency of the dependent adds.
+        /// Accumulation::Double widens float packets into double accumulators after the elements are computed.
+        template <Accumulation _Acc, typename _Expr, typename _Op>
+        constexpr AccumulatorType<_Expr, _Acc> ReduceRange(const _Expr &expr, const _Op &op, size_t begin, size_t end)
+        {
+            using ValueType = ExprValueType<_Expr>;
+            using AccType = AccumulatorType<_Expr, _Acc>;
+            if constexpr (_Acc == Accumulation::Kahan)
+            {
+                if (!std::is_constant_evaluated())
+                    return ReduceKahan(expr, op, begin, end);
+            }
+            AccType acc(0);
+            size_t index = begin;
+            if constexpr (packetable<_Expr, ValueType> && std::is_same_v<AccType, ValueType>)
+            {
+                constexpr size_t width = simd::Packet<ValueType>::Size;
+                if (!std::is_constant_evaluated() && index + width <= end)
+                {
+                    const simd::Packet<ValueType> zero = simd::Set1(ValueType(0));
+                    simd::Packet<ValueType> acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+                    for (; index + 4 * width <= end; index += 4 * width)
+                    {
+                        acc0 = op.Packet(acc0, expr.template Packet<ValueType>(index));
+                        acc1 = op.Packet(acc1, expr.template Packet<ValueType>(index + width));
+                        acc2 = op.Packet(acc2, expr.template Packet<ValueType>(index + 2 * width));
+                        acc3 = op.Packet(acc3, expr.template Packet<ValueType>(index + 3 * width));
+                    }
+                    for (; index + width <= end; index += width)
+                        acc0 = op.Packet(acc0, expr.template Packet<ValueType>(index));
+                    acc = op.Horizontal(op.Combine(op.Combine(acc0, acc1), op.Combine(acc2, acc3)));
+                }
+            }
+            else if constexpr (packetable<_Expr, float> && std::is_same_v<ValueType, float> && std::is_same_v<AccType, double>)
+            {
+                constexpr size_t width = simd::Packet<float>::Size;
+                constexpr bool twoHalves = width == 2 * simd::Packet<double>::Size;
+                if (!std::is_constant_evaluated() && index + width <= end)
+                {
+                    const simd::Packet<double> zero = simd::Set1(0.0);
+                    simd::Packet<double> acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+                    for (; index + 2 * width <= end; index += 2 * width)
+                    {
+                        const simd::Packet<float> x0 = expr.template Packet<float>(index);
+                        const simd::Packet<float> x1 = expr.template Packet<float>(index + width);
+                        acc0 = op.Packet(acc0, simd::WidenLow(x0));
+                        acc2 = op.Packet(acc2, simd::WidenLow(x1));
+                        if constexpr (twoHalves)
+                        {
+                            acc1 = op.Packet(acc1, simd::WidenHigh(x0));
+                            acc3 = op.Packet(acc3, simd::WidenHigh(x1));
+                        }
+                    }
+                    for (; index + width <= end; index += width)
+                    {
+                        const simd::Packet<float> x = expr.template Packet<float>(index);
+                        acc0 = op.Packet(acc0, simd::WidenLow(x));
+                        if constexpr (twoHalves)
+                            acc1 = op.Packet(acc1, simd::WidenHigh(x));
+                    }
+                    acc = op.Horizontal(op.Combine(op.Combine(acc0, acc1), op.Combine(acc2, acc3)));
+                }
+            }
+            for (; index < end; ++index)
+                acc = op(acc, static_cast<AccType>(expr.At(index)));
+            return acc;
+        }
+
+        /// @brief Fold every element of expr in one pass, nothing in the tree is materialized besides cached products.
+        /// Above ReduceGrain elements the fold runs in ReduceGrain tasks combined in order, on the thread pool
+        /// when the expression is large and lives on the heap.
+        /// @tparam _Acc Precision of the running sums, only additive ops take Accumulation::Kahan
+        template <Accumulation _Acc = Accumulation::Native, typename _Expr, typename _Op>
+        constexpr AccumulatorType<_Expr, _Acc> Reduce(const _Expr &expr, const _Op &op)
+        {
+            using AccType = AccumulatorType<_Expr, _Acc>;
+            const size_t size = expr.Row() * expr.Col();
+            if (size <= ReduceGrain)
+                return ReduceRange<_Acc>(expr, op, 0, size);
+            const size_t tasks = (size + ReduceGrain - 1) / ReduceGrain;
+            const auto task = [&](size_t index)
+            { return ReduceRange<_Acc>(expr, op, index * ReduceGrain, std::min(size, (index + 1) * ReduceGrain)); };
+            // partial sums of a compensated fold are combined with compensation too
+            const auto combine = [&](const auto &partial)
+            {
+                if constexpr (_Acc == Accumulation::Kahan)
+                {
+                    KahanSum<AccType> acc;
+                    for (size_t index = 0; index < tasks; ++index)
+                        acc.Add(partial(index));
+                    return acc.sum;
+                }
+                else
+                {
+                    AccType acc = partial(0);
+                    for (size_t index = 1; index < tasks; ++index)
+                        acc = op.Combine(acc, partial(index));
+                    return acc;
+                }
+            };
+            if constexpr (!_Expr::IsInStack())
+            {
+                if (Work<_Expr>(size) >= parallel::Threshold() && std::min(parallel::ThreadPool::Instance().ThreadCount(), parallel::MaxThreads()) > 1)
+                {
+                    memory::ArenaScope scope;
+                    expr.Prepare();
+                    ScratchBuffer<AccType> partial(tasks);
+                    parallel::ParallelRanges(tasks, 1, [&](size_t begin, size_t end)
+                                             {
+                        for (size_t index = begin; index < end; ++index)
+                            partial[index] = task(index); });
+                    return combine([&](size_t index)
+                                   { return partial[index]; });
+                }
+            }
+            return combine(task);
+        }
+#pragma endregion
+
         /// @brief Base Template Expression
         /// @tparam Derived Operator
         template <typename _Derived>
         class Expr
         {
         protected:
-            explicit Expr() {}
-            auto operator[](size_t index) const { return GetDerived().At(index); }
+            constexpr explicit Expr() {}
+            constexpr auto operator[](size_t index) const { return GetDerived().At(index); }
             constexpr size_t Row() const { return GetDerived().GetRow(); }
             constexpr size_t Col() const { return GetDerived().GetCol(); }
             auto operator()() const { return GetDerived()(); }
 
         public:
-            const _Derived &GetDerived() const { return static_cast<const _Derived &>(*this); }
-            _Derived &GetDerived() { return static_cast<_Derived &>(*this); }
+            constexpr const _Derived &GetDerived() const { return static_cast<const _Derived &>(*this); }
+            constexpr _Derived &GetDerived() { return static_cast<_Derived &>(*this); }
+            template <typename _Other>
+            constexpr bool IsSizeMatch(const _Other &other) const
+            {
+                return Row() == other.Row() && Col() == other.Col();
+            }
+            /// @brief Write every element into contiguous row-major storage
+            /// @param dst Buffer holding at least Row() * Col() elements
+            template <typename _Ty>
+            constexpr void EvaluateTo(_Ty *dst) const
+            {
+                if constexpr (kernel::Unrollable(_Derived::RowsAtCompileTime, _Derived::ColsAtCompileTime))
+                    EvaluateUnrolled(dst);
+                else
+                {
+                    [[maybe_unused]] EvaluationScope<_Derived> scope;
+                    const size_t size = Row() * Col();
+                    if constexpr (!_Derived::IsInStack())
+                    {
+                        if (Work<_Derived>(size) >= parallel::Threshold())
+                        {
+                            GetDerived().Prepare();
+                            parallel::ParallelFor(dst, size, [&](size_t begin, size_t end)
+                                                  { EvaluateRange(dst, begin, end); });
+                            return;
+                        }
+                    }
+                    EvaluateRange(dst, 0, size);
+                }
+            }
+            /// @brief Write every element through row and column strides, e.g. into a block of a larger matrix
+            template <typename _Ty>
+            void EvaluateTo(kernel::StridedRef<_Ty> dst) const
+            {
+                [[maybe_unused]] EvaluationScope<_Derived> scope;
+                const size_t rows = Row(), cols = Col();
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    size_t j = 0;
+                    if constexpr (StoresPackets<_Ty>())
+                    {
+                        constexpr size_t width = simd::Packet<ExprValueType<_Derived>>::Size;
+                        if (dst.colStride == 1)
+                            for (; j + width <= cols; j += width)
+                                StorePacket(&dst(i, j), i * cols + j);
+                    }
+                    // counting down keeps the trip count visible once the packet loop is unrolled
+                    for (size_t count = cols - j; count-- > 0; ++j)
+                        dst(i, j) = GetDerived().At(i * cols + j);
+                }
+            }
+            /// @brief Write elements [begin, end) into dst, packet by packet with a scalar tail
+            template <typename _Ty>
+            void EvaluateRange(_Ty *dst, size_t begin, size_t end) const
+            {
+                size_t index = begin;
+                if constexpr (StoresPackets<_Ty>())
+                {
+                    constexpr size_t width = simd::Packet<ExprValueType<_Derived>>::Size;
+                    for (; index + width <= end; index += width)
+                        StorePacket(dst + index, index);
+                }
+                for (size_t count = end - index; count-- > 0; ++index)
+                    dst[index] = GetDerived().At(index);
+            }
+            /// @brief Straight-line evaluation of a small fixed-size tree, usable in constant expressions
+            template <typename _Ty>
+            constexpr void EvaluateUnrolled(_Ty *dst) const
+            {
+                constexpr size_t size = _Derived::RowsAtCompileTime * _Derived::ColsAtCompileTime;
+                if (std::is_constant_evaluated())
+                {
+                    kernel::Unroll<size>([&](auto index)
+                                         { dst[index] = GetDerived().At(index); });
+                    return;
+                }
+                if constexpr (StoresPackets<_Ty>())
+                {
+                    constexpr size_t width = simd::Packet<ExprValueType<_Derived>>::Size;
+                    constexpr size_t tail = size / width * width;
+                    kernel::Unroll<size / width>([&](auto index)
+                                                 { StorePacket(dst + index * width, index * width); });
+                    kernel::Unroll<size - tail>([&](auto index)
+                                                { dst[tail + index] = GetDerived().At(tail + index); });
+                }
+                else
+                    kernel::Unroll<size>([&](auto index)
+                                         { dst[index] = GetDerived().At(index); });
+            }
+            /// @brief Compute every cached subresult up front so the tree can be read from several threads
+            void Prepare() const {}
+            /// @brief Whether a _Ty destination is written a packet at a time. Packets are computed in the element type
+            /// of the expression and converted while stored, the same rounding as the scalar tail.
+            template <typename _Ty>
+            static constexpr bool StoresPackets()
+            {
+                using ValueType = ExprValueType<_Derived>;
+                return packetable<_Derived, ValueType> && simd::convertible<ValueType, _Ty>;
+            }
+            template <typename _Ty>
+            void StorePacket(_Ty *dst, size_t index) const
+            {
+                using ValueType = ExprValueType<_Derived>;
+                if constexpr (std::is_same_v<_Ty, ValueType>)
+                    simd::Store(dst, GetDerived().template Packet<ValueType>(index));
+                else
+                    simd::StoreAs(dst, GetDerived().template Packet<ValueType>(index));
+            }
+            template <typename _Ty>
+                requires std::constructible_from<_Ty, size_t, size_t> && requires(_Ty &res) { res.Data(); }
+            constexpr operator _Ty() const
+            {
+                _Ty res(Row(), Col());
+                CheckSameSize(GetDerived(), res);
+                GetDerived().EvaluateTo(res.Data());
+                instrument::RecordEvaluation<_Derived>(Row() * Col());
+                return res;
+            }
+            /// @brief Evaluate into the matrix type deduced from the compile-time shape,
+            /// stack-backed when both extents are fixed and small
+            constexpr auto Eval() const
+            {
+                constexpr size_t rows = _Derived::RowsAtCompileTime;
+                constexpr size_t cols = _Derived::ColsAtCompileTime;
+                using ValueType = ExprValueType<_Derived>;
+                if constexpr (IsFixed(rows) && IsFixed(cols))
+                    return static_cast<Matrix<rows, cols, ValueType, std::allocator<ValueType>>>(*this);
+                else
+                    return static_cast<Matrix<Dynamic, Dynamic, ValueType, std::allocator<ValueType>>>(*this);
+            }
+            /// @brief Lazy transpose, element (i, j) reads element (j, i) of this expression
+            constexpr auto Transpose() const { return TransposeExpr<_Derived>(GetDerived()); }
+
+#pragma region "Reductions"
+            /// @brief Sum of all elements
+            /// @tparam _Acc Accumulation::Double sums float elements in double, Accumulation::Kahan compensates
+            template <Accumulation _Acc = Accumulation::Native>
+            constexpr auto Sum() const { return Reduce<_Acc>(GetDerived(), SumReduction{}); }
+            /// @brief Sum of squared elements, (a - b).SquaredNorm() never materializes a - b
+            template <Accumulation _Acc = Accumulation::Native>
+            constexpr auto SquaredNorm() const { return Reduce<_Acc>(GetDerived(), SquaredNormReduction{}); }
+            /// @brief Frobenius norm, the Euclidean norm of a vector
+            template <Accumulation _Acc = Accumulation::Native>
+            auto Norm() const { return std::sqrt(SquaredNorm<_Acc>()); }
+            /// @brief Largest absolute element, 0 for an empty expression
+            constexpr auto MaxAbs() const { return Reduce(GetDerived(), MaxAbsReduction{}); }
+            /// @brief Sum of the main diagonal, the expression need not be square
+            constexpr auto Trace() const
+            {
+                ExprValueType<_Derived> acc(0);
+                const size_t n = std::min(Row(), Col());
+                for (size_t i = 0; i < n; ++i)
+                    acc += GetDerived().At(i * Col() + i);
+                return acc;
+            }
+            /// @brief Frobenius inner product Σ aᵢⱼ bᵢⱼ, the dot product for two vectors of the same shape
+            template <Accumulation _Acc = Accumulation::Native, expression _Ty>
+            constexpr auto Dot(const _Ty &rhs) const
+            {
+                CheckSameSize(GetDerived(), rhs);
+                return Reduce<_Acc>(BinaryOperator<MultipleOperatorType, _Derived, _Ty>(mulOpt, GetDerived(), rhs), SumReduction{});
+            }
+            template <Accumulation _Acc = Accumulation::Native, leaf _Ty>
+            constexpr auto Dot(const _Ty &rhs) const { return Dot<_Acc>(ExprStart<_Ty>(rhs)); }
+#pragma endregion
+
+#pragma region "Operator overloading"
+            /// @brief AddOperator
+            /// @tparam _Ty Template Expression
+            /// @param rhs Expression
+            template <expression _Ty>
+            constexpr auto operator+(const _Ty &rhs) const
+            {
+                CheckSameSize(GetDerived(), rhs);
+                return BinaryOperator<AddOperatorType, _Derived, _Ty>(addOpt, GetDerived(), rhs);
+            }
+            /// @brief AddOperator
+            /// @tparam _Ty MatrixType
+            /// @param rhs Matrix
+            template <leaf _Ty>
+            constexpr auto operator+(const _Ty &rhs) const
+            {
+                CheckSameSize(GetDerived(), rhs);
+                using ExprT = ExprStart<_Ty>;
+                return BinaryOperator<AddOperatorType, _Derived, ExprT>(addOpt, GetDerived(), ExprT(rhs));
+            }
+            /// @brief AddOperator
+            /// @tparam _Ty Arithmetic Type
+            /// @param rhs Number
+            template <arithmetic _Ty>
+            constexpr auto operator+(const _Ty &rhs) const
+            {
+                using ExprT = ExprStart<ExprScalar<ScalarType<ExprValueType<_Derived>, _Ty>>>;
+                return BinaryOperator<AddOperatorType, _Derived, ExprT>(addOpt, GetDerived(), ExprT(rhs));
+            }
+            /// @brief SubtractOperator
+            /// @tparam _Ty Template Expression
+            /// @param rhs Expression
+            template <expression _Ty>
+            constexpr auto operator-(const _Ty &rhs) const
+            {
+                CheckSameSize(GetDerived(), rhs);
+                return BinaryOperator<SubtractOperatorType, _Derived, _Ty>(subOpt, GetDerived(), rhs);
+            }
+            /// @brief SubtractOperator
+            /// @tparam _Ty MatrixType
+            /// @param rhs Matrix
+            template <leaf _Ty>
+            constexpr auto operator-(const _Ty &rhs) const
+            {
+                CheckSameSize(GetDerived(), rhs);
+                using ExprT = ExprStart<_Ty>;
+                return BinaryOperator<SubtractOperatorType, _Derived, ExprT>(subOpt, GetDerived(), ExprT(rhs));
+            }
+            /// @brief SubtractOperator
+            /// @tparam _Ty Arithmetic Type
+            /// @param rhs Number
+            template <arithmetic _Ty>
+            constexpr auto operator-(const _Ty &rhs) const
+            {
+                using ExprT = ExprStart<ExprScalar<ScalarType<ExprValueType<_Derived>, _Ty>>>;
+                return BinaryOperator<SubtractOperatorType, _Derived, ExprT>(subOpt, GetDerived(), ExprT(rhs));
+            }
+            /// @brief ProductOperator
+            /// @tparam _Ty Template Expression
+            /// @param rhs Expression
+            template <expression _Ty>
+            constexpr auto operator*(const _Ty &rhs) const
+            {
+                CheckProductSize(GetDerived(), rhs);
+                return ProductExpr<_Derived, _Ty>(GetDerived(), rhs);
+            }
+            /// @brief ProductOperator
+            /// @tparam _Ty MatrixType
+            /// @param rhs Matrix
+            template <leaf _Ty>
+            constexpr auto operator*(const _Ty &rhs) const
+            {
+                CheckProductSize(GetDerived(), rhs);
+                using ExprT = ExprStart<_Ty>;
+                return ProductExpr<_Derived, ExprT>(GetDerived(), ExprT(rhs));
+            }
+            /// @brief MultipleOperator
+            /// @tparam _Ty Arithmetic Type
+            /// @param rhs Number
+            template <arithmetic _Ty>
+            constexpr auto operator*(const _Ty &rhs) const
+            {
+                using ExprT = ExprStart<ExprScalar<ScalarType<ExprValueType<_Derived>, _Ty>>>;
+                return BinaryOperator<MultipleOperatorType, _Derived, ExprT>(mulOpt, GetDerived(), ExprT(rhs));
+            }
+            /// @brief DivideOperator
+            /// @tparam _Ty Arithmetic Type
+            /// @param rhs Number
+            template <arithmetic _Ty>
+            constexpr auto operator/(const _Ty &rhs) const
+            {
+                using ExprT = ExprStart<ExprScalar<ScalarType<ExprValueType<_Derived>, _Ty>>>;
+                return BinaryOperator<DivideOperatorType, _Derived, ExprT>(divOpt, GetDerived(), ExprT(rhs));
+            }
+#pragma endregion
         };
 
-        template <typename _Ty>
-        concept expression = std::derived_from<_Ty, Expr<_Ty>>;
+        template <arithmetic _Num, expression _Ty>
+        constexpr auto operator*(const _Num &num, const _Ty &expr)
+        {
+            return expr * num;
+        }
 
         /// @brief Scalar Template Expression
         /// @tparam _Ty Arithmetic Type
@@ -87,25 +831,31 @@ namespace LinerAlgebra
         struct ExprScalar
         {
         private:
-            const _Ty &s;
+            // held by value, the operand is usually a temporary that dies before an auto expression is evaluated
+            _Ty s;
 
         public:
             constexpr ExprScalar(const _Ty &s) : s(s) {}
             constexpr const _Ty &operator[](size_t) const { return s; }
+            template <typename _PTy>
+            simd::Packet<_PTy> Packet(size_t) const { return simd::Set1(static_cast<_PTy>(s)); }
+            static constexpr size_t RowsAtCompileTime = Broadcast;
+            static constexpr size_t ColsAtCompileTime = Broadcast;
             constexpr size_t Row() const { return 0; }
             constexpr size_t Col() const { return 0; }
+            constexpr static bool IsInStack() { return true; }
         };
 
         template <typename _Ty>
         struct ExprTraits
         {
-            using Type = typename const _Ty &;
+            using Type = const _Ty &;
         };
 
         template <typename _Ty>
         struct ExprTraits<ExprScalar<_Ty>>
         {
-            using Type = typename ExprScalar<_Ty>;
+            using Type = ExprScalar<_Ty>;
         };
 
         /// @brief Start Evaluation
@@ -113,19 +863,37 @@ namespace LinerAlgebra
         template <typename _Ty>
         class ExprStart : public Expr<ExprStart<_Ty>>
         {
-            ExprTraits<_Ty>::Type value;
+            typename ExprTraits<_Ty>::Type value;
 
         public:
-            using BaseType = typename Expr<ExprStart<_Ty>>;
+            using BaseType = Expr<ExprStart<_Ty>>;
             using BaseType::operator[];
             using BaseType::Col;
             using BaseType::Row;
 
-            explicit ExprStart(const _Ty &value) : value(value) {}
-            size_t GetRow() const { return value.Row(); }
-            size_t GetCol() const { return value.Col(); }
-            auto At(size_t index) const { return value[index]; }
-            decltype(auto) operator()() const { return (value); }
+            static constexpr size_t RowsAtCompileTime = _Ty::RowsAtCompileTime;
+            static constexpr size_t ColsAtCompileTime = _Ty::ColsAtCompileTime;
+
+            constexpr explicit ExprStart(const _Ty &value) : value(value) {}
+            constexpr static bool IsInStack() { return _Ty::IsInStack(); }
+            /// @brief Element i only reads element i of the leaves, so the result may overwrite a leaf
+            static constexpr bool IsElementwise = true;
+            static constexpr size_t Cost = 0;
+            constexpr size_t GetRow() const { return Extent<RowsAtCompileTime>(value.Row()); }
+            constexpr size_t GetCol() const { return Extent<ColsAtCompileTime>(value.Col()); }
+            constexpr auto At(size_t index) const { return value[index]; }
+            template <typename _PTy>
+                requires packetable<_Ty, _PTy> || contiguous<_Ty, _PTy> || widenable<_Ty, _PTy>
+            simd::Packet<_PTy> Packet(size_t index) const
+            {
+                if constexpr (packetable<_Ty, _PTy>)
+                    return value.template Packet<_PTy>(index);
+                else if constexpr (contiguous<_Ty, _PTy>)
+                    return simd::Load(value.Data() + index);
+                else
+                    return simd::LoadAs<_PTy>(value.Data() + index);
+            }
+            constexpr decltype(auto) operator()() const { return (value); }
         };
 
         /// @brief Binary Operator Template
@@ -140,100 +908,536 @@ namespace LinerAlgebra
             _RExpr rExpr;
 
         public:
-            using BaseType = typename Expr<BinaryOperator<_BiFunc, _LExpr, _RExpr>>;
+            using BaseType = Expr<BinaryOperator<_BiFunc, _LExpr, _RExpr>>;
             using BaseType::operator[];
             using BaseType::Col;
             using BaseType::Row;
 
-            explicit BinaryOperator(const _BiFunc &func, const _LExpr &lExpr, const _RExpr &rExpr)
+            static constexpr size_t RowsAtCompileTime = DimCombine(_LExpr::RowsAtCompileTime, _RExpr::RowsAtCompileTime);
+            static constexpr size_t ColsAtCompileTime = DimCombine(_LExpr::ColsAtCompileTime, _RExpr::ColsAtCompileTime);
+
+            constexpr explicit BinaryOperator(const _BiFunc &func, const _LExpr &lExpr, const _RExpr &rExpr)
                 : biFunc(func), lExpr(lExpr), rExpr(rExpr) {}
-            auto At(size_t index) const { return biFunc(lExpr[index], rExpr[index]); }
-            constexpr size_t GetRow() const { return Max(lExpr.Row(), rExpr.Row()); }
-            constexpr size_t GetCol() const { return Max(lExpr.Col(), rExpr.Col()); }
-            template <template <size_t, size_t, typename> class _T, size_t _Row, size_t _Col, typename _Ty>
-            constexpr bool IsSizeMatch(const _T<_Row, _Col, _Ty> &other)
+            constexpr auto At(size_t index) const { return biFunc(lExpr[index], rExpr[index]); }
+            template <typename _Ty>
+                requires packetable<_LExpr, _Ty> && packetable<_RExpr, _Ty>
+            simd::Packet<_Ty> Packet(size_t index) const
             {
-                return Row() == other.Row() && Col() == other.Col();
+                return biFunc.Packet(lExpr.template Packet<_Ty>(index), rExpr.template Packet<_Ty>(index));
+            }
+            constexpr size_t GetRow() const { return Extent<RowsAtCompileTime>(Max(lExpr.Row(), rExpr.Row())); }
+            constexpr size_t GetCol() const { return Extent<ColsAtCompileTime>(Max(lExpr.Col(), rExpr.Col())); }
+            constexpr static bool IsInStack() { return _LExpr::IsInStack() && _RExpr::IsInStack(); }
+            static constexpr bool IsElementwise = _LExpr::IsElementwise && _RExpr::IsElementwise;
+            static constexpr bool HoldsCache = caching<_LExpr> || caching<_RExpr>;
+            static constexpr size_t Cost = _LExpr::Cost + _RExpr::Cost + _BiFunc::Cost;
+            void Prepare() const
+            {
+                lExpr.Prepare();
+                rExpr.Prepare();
             }
+        };
+
+        /// @brief Contiguous row-major data of an operand, evaluating it into buffer only when it is not a plain matrix
+        /// @param expr Operand expression
+        /// @param buffer Storage used when the operand has to be materialized
+        template <typename _Ty, typename _Alloc, typename _Expr>
+        const _Ty *Materialize(const _Expr &expr, std::vector<_Ty, _Alloc> &buffer)
+        {
+            if constexpr (requires { { expr().Data() } -> std::convertible_to<const _Ty *>; })
+                return expr().Data();
+            else
+            {
+                buffer.resize(expr.Row() * expr.Col());
+                expr.EvaluateTo(buffer.data());
+                instrument::RecordEvaluation<_Expr>(buffer.size());
+                instrument::RecordTemporary<_Expr>();
+                return buffer.data();
+            }
+        }
+
+        /// @brief Stack counterpart of Materialize for operands with a small fixed shape
+        template <typename _Ty, size_t _N, typename _Expr>
+        constexpr const _Ty *Materialize(const _Expr &expr, std::array<_Ty, _N> &buffer)
+        {
+            if constexpr (requires { { expr().Data() } -> std::convertible_to<const _Ty *>; })
+                return expr().Data();
+            else
+            {
+                expr.EvaluateTo(buffer.data());
+                instrument::RecordEvaluation<_Expr>(_N);
+                instrument::RecordTemporary<_Expr>();
+                return buffer.data();
+            }
+        }
+
+        /// @brief Strided access to a product operand: views and matrices are read in place, anything else is evaluated into buffer
+        template <typename _Ty, typename _Alloc, typename _Expr>
+        kernel::StridedRef<const _Ty> Operand(const _Expr &expr, std::vector<_Ty, _Alloc> &buffer)
+        {
+            if constexpr (requires { { expr.Ref() } -> std::convertible_to<kernel::StridedRef<const _Ty>>; })
+                return expr.Ref();
+            else
+                return {Materialize(expr, buffer), expr.Col(), 1};
+        }
+
+        /// @brief Transpose of an arbitrary expression. Products read it as swapped strides over the
+        /// nested operand, materializing goes through a tiled copy instead of striding over the destination.
+        /// Inside a larger expression a nested expression that computes anything is transposed once into a cache,
+        /// reading it element by element would walk every operand a whole row apart.
+        /// @tparam _Expr Transposed Expression
+        template <typename _Expr>
+        class TransposeExpr : public Expr<TransposeExpr<_Expr>>
+        {
+        public:
+            using ValueType = ExprValueType<_Expr>;
+            static constexpr size_t RowsAtCompileTime = _Expr::ColsAtCompileTime;
+            static constexpr size_t ColsAtCompileTime = _Expr::RowsAtCompileTime;
+            static constexpr bool IsCached = _Expr::Cost > 0 && !kernel::Unrollable(RowsAtCompileTime, ColsAtCompileTime);
+
+        private:
+            using CacheType = std::conditional_t<IsCached, ResultCache<ValueType>, std::array<ValueType, 0>>;
+
+            _Expr expr;
+            mutable CacheType transposed{};
+
+            bool IsEvaluated() const
+            {
+                if constexpr (IsCached)
+                    return transposed.IsFilled();
+                else
+                    return false;
+            }
+            const CacheType &Evaluated() const
+            {
+                if (!IsEvaluated())
+                {
+                    TransposeTo(kernel::StridedRef<ValueType>{transposed.Allocate(GetRow() * GetCol()), GetCol(), 1});
+                    instrument::RecordEvaluation<TransposeExpr>(transposed.size());
+                    instrument::RecordTemporary<TransposeExpr>();
+                }
+                return transposed;
+            }
+            /// @brief Evaluate the nested expression in its own order, then copy it across tile by tile
             template <typename _Ty>
-            operator _Ty()
+            void TransposeTo(kernel::StridedRef<_Ty> dst) const
             {
-                _Ty res(GetRow(), GetCol());
-                for (size_t index = 0; index < res.Size(); ++index)
-                    res[index] = (*this)[index];
-                return res;
+                memory::ArenaScope scope;
+                ScratchBuffer<_Ty> buffer;
+                kernel::CopyTiled<_Ty>(GetRow(), GetCol(), Operand(*this, buffer), dst);
             }
-            /// @brief Addoperator
-            /// @tparam _Ty Template Expression
-            /// @param rhs Expression
-            template <expression _Ty>
-            auto operator+(const _Ty &rhs)
+
+        public:
+            using BaseType = Expr<TransposeExpr<_Expr>>;
+            using BaseType::operator[];
+            using BaseType::Col;
+            using BaseType::Row;
+
+            constexpr explicit TransposeExpr(const _Expr &expr) : expr(expr) {}
+            constexpr size_t GetRow() const { return Extent<RowsAtCompileTime>(expr.Col()); }
+            constexpr size_t GetCol() const { return Extent<ColsAtCompileTime>(expr.Row()); }
+            constexpr static bool IsInStack() { return _Expr::IsInStack(); }
+            // element (i, j) reads (j, i) of the operands
+            static constexpr bool IsElementwise = false;
+            static constexpr bool HoldsCache = IsCached || caching<_Expr>;
+            static constexpr size_t Cost = IsCached ? 0 : _Expr::Cost;
+            void Prepare() const
             {
-                return BinaryOperator<AddOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, _Ty>(addOpt, *this, rhs);
+                if constexpr (IsCached)
+                    Evaluated();
+                else
+                    expr.Prepare();
             }
-            /// @brief AddOperator
-            /// @tparam _Ty MatrixType
-            /// @param rhs Matrix
-            template <template <size_t, size_t, typename> class _T, size_t _Row, size_t _Col, typename _Ty>
-            auto operator+(const _T<_Row, _Col, _Ty> &rhs)
+            constexpr auto At(size_t index) const
             {
-                if (!IsSizeMatch(rhs))
-                    throw SizeExcept();
-                using ExprT = ExprStart<_T<_Row, _Col, _Ty>>;
-                return BinaryOperator<AddOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(addOpt, *this, ExprT(rhs));
+                if constexpr (IsCached)
+                    return Evaluated()[index];
+                else
+                    return expr.At(index % GetCol() * GetRow() + index / GetCol());
             }
-            /// @brief AddOperator
-            /// @tparam _Ty Arithmetic Type
-            /// @param rhs Number
-            template <arithmetic _Ty>
-            auto operator+(const _Ty &rhs)
+            template <typename _Ty>
+                requires IsCached && std::same_as<_Ty, ValueType>
+            simd::Packet<_Ty> Packet(size_t index) const
             {
-                using ExprT = ExprStart<ExprScalar<_Ty>>;
-                return BinaryOperator<AddOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(addOpt, *this, ExprT(rhs));
+                return simd::Load(Evaluated().data() + index);
             }
-            /// @brief SubtractOperator
-            /// @tparam _Ty Template Expression
-            /// @param rhs Expression
-            template <expression _Ty>
-            auto operator-(const _Ty &rhs)
+            constexpr const _Expr &Nested() const { return expr; }
+            /// @brief Transposing twice gives the nested expression back
+            constexpr const _Expr &Transpose() const { return expr; }
+            template <typename _Ty>
+            constexpr void EvaluateTo(_Ty *dst) const
             {
-                return BinaryOperator<SubtractOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, _Ty>(subOpt, *this, rhs);
+                if constexpr (kernel::Unrollable(RowsAtCompileTime, ColsAtCompileTime))
+                    BaseType::EvaluateTo(dst);
+                else
+                    EvaluateTo(kernel::StridedRef<_Ty>{dst, GetCol(), 1});
             }
-            /// @brief SubtractOperator
-            /// @tparam _Ty MatrixType
-            /// @param rhs Matrix
-            template <template <size_t, size_t, typename> class _T, size_t _Row, size_t _Col, typename _Ty>
-            auto operator-(const _T<_Row, _Col, _Ty> &rhs)
+            /// @brief Copy the cache when there is one, otherwise transpose straight into dst
+            template <typename _Ty>
+            void EvaluateTo(kernel::StridedRef<_Ty> dst) const
             {
-                if (!IsSizeMatch(rhs))
+                if (IsEvaluated())
+                {
+                    for (size_t i = 0; i < GetRow(); ++i)
+                        for (size_t j = 0; j < GetCol(); ++j)
+                            dst(i, j) = static_cast<_Ty>(transposed[i * GetCol() + j]);
+                    return;
+                }
+                TransposeTo(dst);
+            }
+        };
+
+        /// @brief A transposed operand is the nested operand with its strides swapped
+        template <typename _Ty, typename _Alloc, typename _Expr>
+        kernel::StridedRef<const _Ty> Operand(const TransposeExpr<_Expr> &expr, std::vector<_Ty, _Alloc> &buffer)
+        {
+            return Operand(expr.Nested(), buffer).Transposed();
+        }
+
+        /// @brief Matrix Product Template
+        /// @tparam _LExpr Left Expression
+        /// @tparam _RExpr Right Expression
+        /// @tparam _Acc Precision of the dot products, see Product()
+        template <typename _LExpr, typename _RExpr, Accumulation _Acc>
+        class ProductExpr : public Expr<ProductExpr<_LExpr, _RExpr, _Acc>>
+        {
+        public:
+            using ValueType = std::common_type_t<ExprValueType<_LExpr>, ExprValueType<_RExpr>>;
+            static constexpr size_t RowsAtCompileTime = _LExpr::RowsAtCompileTime;
+            static constexpr size_t ColsAtCompileTime = _RExpr::ColsAtCompileTime;
+            static constexpr size_t InnerAtCompileTime = _LExpr::ColsAtCompileTime;
+            // small fixed products use the unrolled kernel and keep their result on the stack
+            static constexpr bool IsUnrolled = kernel::Unrollable(RowsAtCompileTime, InnerAtCompileTime) &&
+                                               kernel::Unrollable(InnerAtCompileTime, ColsAtCompileTime) &&
+                                               _Acc == Accumulation::Native;
+
+        private:
+            using CacheType = std::conditional_t<IsUnrolled, std::array<ValueType, RowsAtCompileTime * ColsAtCompileTime>,
+                                                 ResultCache<ValueType>>;
+
+            _LExpr lExpr;
+            _RExpr rExpr;
+            // Filled on the first element access, so a product nested in a larger expression is computed once
+            mutable CacheType product{};
+            mutable bool evaluated = false; // the stack cache of unrolled products, the arena cache knows by itself
+
+            constexpr bool IsEvaluated() const
+            {
+                if constexpr (IsUnrolled)
+                    return evaluated;
+                else
+                    return product.IsFilled();
+            }
+            constexpr const CacheType &Evaluated() const
+            {
+                if (!IsEvaluated())
+                {
+                    if constexpr (IsUnrolled)
+                    {
+                        EvaluateTo(product.data());
+                        evaluated = true;
+                    }
+                    else
+                        EvaluateTo(product.Allocate(GetRow() * GetCol()));
+                    instrument::RecordEvaluation<ProductExpr>(product.size());
+                    instrument::RecordTemporary<ProductExpr>();
+                }
+                return product;
+            }
+
+        public:
+            using BaseType = Expr<ProductExpr<_LExpr, _RExpr, _Acc>>;
+            using BaseType::operator[];
+            using BaseType::Col;
+            using BaseType::Row;
+
+            constexpr explicit ProductExpr(const _LExpr &lExpr, const _RExpr &rExpr) : lExpr(lExpr), rExpr(rExpr) {}
+            constexpr size_t GetRow() const { return Extent<RowsAtCompileTime>(lExpr.Row()); }
+            constexpr size_t GetCol() const { return Extent<ColsAtCompileTime>(rExpr.Col()); }
+            constexpr static bool IsInStack() { return _LExpr::IsInStack() && _RExpr::IsInStack(); }
+            // GEMM writes the destination while it still reads the operands
+            static constexpr bool IsElementwise = false;
+            static constexpr bool HoldsCache = !IsUnrolled || caching<_LExpr> || caching<_RExpr>;
+            // elements are read from the cache, the multiply itself runs once in Prepare or EvaluateTo
+            static constexpr size_t Cost = 0;
+            constexpr void Prepare() const { Evaluated(); }
+            constexpr auto At(size_t index) const { return Evaluated()[index]; }
+            /// @brief Σ lhs(i, p) * rhs(p, i) straight from the operands, O(n²) instead of forming the product
+            constexpr ValueType Trace() const
+            {
+                if (IsEvaluated() || _Acc != Accumulation::Native)
+                    return BaseType::Trace();
+                ValueType acc(0);
+                const size_t n = std::min(GetRow(), GetCol()), inner = lExpr.Col();
+                for (size_t i = 0; i < n; ++i)
+                    for (size_t p = 0; p < inner; ++p)
+                        acc += lExpr.At(i * inner + p) * rExpr.At(p * GetCol() + i);
+                return acc;
+            }
+            template <typename _Ty>
+                requires std::same_as<_Ty, ValueType>
+            simd::Packet<_Ty> Packet(size_t index) const
+            {
+                return simd::Load(Evaluated().data() + index);
+            }
+            /// @brief Multiply straight into dst, each operand is materialized at most once.
+            /// Small fixed shapes run the unrolled kernel, everything else the blocked GEMM.
+            template <typename _Ty>
+            constexpr void EvaluateTo(_Ty *dst) const
+            {
+                EvaluateTo(dst, ValueType(1), ValueType(0));
+            }
+            /// @brief dst = alpha * lhs * rhs + beta * dst, which lets += and -= accumulate without a temporary
+            template <typename _Ty>
+            constexpr void EvaluateTo(_Ty *dst, ValueType alpha, ValueType beta) const
+            {
+                if constexpr (!std::is_same_v<_Ty, ValueType> || IsUnrolled)
+                {
+                    if (!std::is_same_v<_Ty, ValueType> || alpha != ValueType(1) || beta != ValueType(0))
+                    {
+                        const auto scale = [&](const auto &buffer)
+                        {
+                            instrument::RecordEvaluation<ProductExpr>(buffer.size());
+                            instrument::RecordTemporary<ProductExpr>();
+                            for (size_t index = 0; index < buffer.size(); ++index)
+                                dst[index] = static_cast<_Ty>(beta == ValueType(0) ? alpha * buffer[index]
+                                                                                   : alpha * buffer[index] + beta * dst[index]);
+                        };
+                        if constexpr (IsUnrolled)
+                        {
+                            CacheType buffer{};
+                            EvaluateTo(buffer.data());
+                            scale(buffer);
+                        }
+                        else
+                        {
+                            memory::ArenaScope scope;
+                            ScratchBuffer<ValueType> buffer(GetRow() * GetCol());
+                            EvaluateTo(buffer.data());
+                            scale(buffer);
+                        }
+                        return;
+                    }
+                }
+                if constexpr (std::is_same_v<_Ty, ValueType>)
+                {
+                    if constexpr (IsUnrolled)
+                    {
+                        std::array<ValueType, RowsAtCompileTime * InnerAtCompileTime> lBuffer{};
+                        std::array<ValueType, InnerAtCompileTime * ColsAtCompileTime> rBuffer{};
+                        kernel::FixedProduct<RowsAtCompileTime, InnerAtCompileTime, ColsAtCompileTime>(
+                            Materialize(lExpr, lBuffer), Materialize(rExpr, rBuffer), dst);
+                    }
+                    else
+                        EvaluateTo(kernel::StridedRef<_Ty>{dst, GetCol(), 1}, alpha, beta);
+                }
+            }
+            /// @brief dst = alpha * lhs * rhs + beta * dst through strides, so a block of a larger matrix is written in place
+            template <typename _Ty>
+            void EvaluateTo(kernel::StridedRef<_Ty> dst, ValueType alpha = ValueType(1), ValueType beta = ValueType(0)) const
+            {
+                if constexpr (std::is_same_v<_Ty, ValueType> && !IsUnrolled)
+                {
+                    // operands that are not plain storage are evaluated once into arena scratch
+                    memory::ArenaScope scope;
+                    ScratchBuffer<ValueType> lBuffer, rBuffer;
+                    const auto lhs = Operand(lExpr, lBuffer);
+                    const auto rhs = Operand(rExpr, rBuffer);
+                    if constexpr (_Acc == Accumulation::Double)
+                        kernel::GemmDouble<ValueType>(GetRow(), GetCol(), lExpr.Col(), alpha, lhs, rhs, beta, dst);
+                    else if constexpr (_Acc == Accumulation::Kahan)
+                        kernel::GemmKahan<ValueType>(GetRow(), GetCol(), lExpr.Col(), alpha, lhs, rhs, beta, dst);
+                    else
+                        kernel::Gemm<ValueType>(GetRow(), GetCol(), lExpr.Col(), alpha, lhs, rhs, beta, dst);
+                }
+                else
+                {
+                    const CacheType &result = Evaluated();
+                    for (size_t i = 0; i < GetRow(); ++i)
+                        for (size_t j = 0; j < GetCol(); ++j)
+                            dst(i, j) = static_cast<_Ty>(beta == ValueType(0) ? alpha * result[i * GetCol() + j]
+                                                                               : alpha * result[i * GetCol() + j] + beta * dst(i, j));
+                }
+            }
+        };
+
+        /// @brief Non-owning window onto matrix storage with independent row and column strides:
+        /// a block, a row, a column or the diagonal. Reads like any expression and writes straight through to the matrix.
+        /// @tparam _Ty Element type, const for a read-only view
+        /// @tparam _Rows Compile-time rows, Dynamic when only known at runtime
+        /// @tparam _Cols Compile-time columns, Dynamic when only known at runtime
+        template <typename _Ty, size_t _Rows, size_t _Cols>
+        class View : public Expr<View<_Ty, _Rows, _Cols>>
+        {
+            kernel::StridedRef<_Ty> ref;
+            size_t rows;
+            size_t cols;
+
+            template <typename _Expr>
+            constexpr View &AssignNoAlias(const _Expr &expr)
+            {
+                CheckSameSize(*this, expr);
+                expr.EvaluateTo(ref);
+                instrument::RecordEvaluation<_Expr>(rows * cols);
+                return *this;
+            }
+            friend class NoAliasProxy<View>;
+
+            template <typename _OTy>
+            static constexpr bool IsInPlace()
+            {
+                if constexpr (expression<_OTy>)
+                    return _OTy::IsElementwise;
+                else
+                    return true;
+            }
+
+        public:
+            using BaseType = Expr<View<_Ty, _Rows, _Cols>>;
+            using BaseType::operator[];
+            using BaseType::Col;
+            using BaseType::Row;
+            using ValueType = std::remove_const_t<_Ty>;
+
+            static constexpr size_t RowsAtCompileTime = _Rows;
+            static constexpr size_t ColsAtCompileTime = _Cols;
+
+            constexpr explicit View(kernel::StridedRef<_Ty> ref, size_t rows, size_t cols) : ref(ref), rows(rows), cols(cols) {}
+            constexpr View(const View &) = default;
+
+            constexpr size_t GetRow() const { return Extent<_Rows>(rows); }
+            constexpr size_t GetCol() const { return Extent<_Cols>(cols); }
+            constexpr static bool IsInStack() { return IsFixed(_Rows) && IsFixed(_Cols); }
+            // element i is not at position i of the underlying matrix, so a view may not overwrite its own storage
+            static constexpr bool IsElementwise = false;
+            static constexpr size_t Cost = 0;
+            constexpr ValueType At(size_t index) const { return ref(index / GetCol(), index % GetCol()); }
+            /// @brief Contiguous load inside a unit-stride row, lane-by-lane gather otherwise
+            template <typename _PTy>
+                requires std::same_as<_PTy, ValueType>
+            simd::Packet<_PTy> Packet(size_t index) const
+            {
+                constexpr size_t width = simd::Packet<_PTy>::Size;
+                const size_t i = index / GetCol(), j = index % GetCol();
+                if (ref.colStride == 1 && j + width <= GetCol())
+                    return simd::Load(static_cast<const _PTy *>(&ref(i, j)));
+                _PTy lanes[width];
+                for (size_t lane = 0; lane < width; ++lane)
+                    lanes[lane] = At(index + lane);
+                return simd::Load(static_cast<const _PTy *>(lanes));
+            }
+            /// @brief Small fixed views unroll, otherwise rows are copied with packets when the view
+            /// reads along them and tile by tile when it reads across them, e.g. a transpose
+            template <typename _PTy>
+            constexpr void EvaluateTo(_PTy *dst) const
+            {
+                if constexpr (kernel::Unrollable(_Rows, _Cols))
+                    BaseType::EvaluateTo(dst);
+                else
+                    EvaluateTo(kernel::StridedRef<_PTy>{dst, GetCol(), 1});
+            }
+            template <typename _PTy>
+            void EvaluateTo(kernel::StridedRef<_PTy> dst) const
+            {
+                if constexpr (std::same_as<_PTy, ValueType>)
+                {
+                    if (ref.colStride != 1 || dst.colStride != 1)
+                    {
+                        kernel::CopyTiled<ValueType>(GetRow(), GetCol(), Ref(), dst);
+                        return;
+                    }
+                }
+                BaseType::EvaluateTo(dst);
+            }
+            /// @brief Read access for the product kernels, which consume the strides without a copy
+            constexpr kernel::StridedRef<const ValueType> Ref() const { return ref; }
+            constexpr kernel::StridedRef<_Ty> Target() const { return ref; }
+            constexpr _Ty &operator()(size_t row, size_t col) const { return ref(row, col); }
+
+            /// @brief Sub-block of this view
+            template <size_t _R, size_t _C>
+            constexpr View<_Ty, _R, _C> Block(size_t row, size_t col) const
+            {
+                if (row + _R > GetRow() || col + _C > GetCol())
                     throw SizeExcept();
-                using ExprT = ExprStart<_T<_Row, _Col, _Ty>>;
-                return BinaryOperator<SubtractOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(subOpt, *this, ExprT(rhs));
+                return View<_Ty, _R, _C>(ref.Block(row, col), _R, _C);
             }
-            /// @brief SubtractOperator
-            /// @tparam _Ty Arithmetic Type
-            /// @param rhs Number
-            template <arithmetic _Ty>
-            auto operator-(const _Ty &rhs)
+            constexpr View<_Ty, Dynamic, Dynamic> Block(size_t row, size_t col, size_t blockRows, size_t blockCols) const
             {
-                using ExprT = ExprStart<ExprScalar<_Ty>>;
-                return BinaryOperator<SubtractOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(subOpt, *this, ExprT(rhs));
+                if (row + blockRows > GetRow() || col + blockCols > GetCol())
+                    throw SizeExcept();
+                return View<_Ty, Dynamic, Dynamic>(ref.Block(row, col), blockRows, blockCols);
             }
-            /// @brief MultipleOperator
-            /// @tparam _Ty Arithmetic Type
-            /// @param rhs Number
-            template <arithmetic _Ty>
-            auto operator*(const _Ty &rhs)
+            /// @brief The same storage read with rows and columns swapped, nothing is copied
+            constexpr View<_Ty, _Cols, _Rows> Transpose() const { return View<_Ty, _Cols, _Rows>(ref.Transposed(), GetCol(), GetRow()); }
+
+#pragma region "Assignment"
+            /// @brief Copy elements into the viewed storage. Elementwise expressions are written in place,
+            /// anything that may read the target elsewhere (views, products) goes through a temporary, use NoAlias() to skip it.
+            template <expression _Expr>
+            constexpr View &operator=(const _Expr &expr)
             {
-                using ExprT = ExprStart<ExprScalar<_Ty>>;
-                return BinaryOperator<MultipleOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(mulOpt, *this, ExprT(rhs));
+                static_assert(!std::is_const_v<_Ty>, "Cannot assign through a read-only view!");
+                if constexpr (_Expr::IsElementwise)
+                    return AssignNoAlias(expr);
+                else
+                {
+                    CheckSameSize(*this, expr);
+                    const auto res = expr.Eval();
+                    instrument::RecordTemporary<_Expr>();
+                    return AssignNoAlias(ExprStart<std::remove_const_t<decltype(res)>>(res));
+                }
             }
-            template <arithmetic _Ty>
-            auto operator/(const _Ty &rhs)
+            template <leaf _OTy>
+            constexpr View &operator=(const _OTy &other) { return *this = ExprStart<_OTy>(other); }
+            /// @brief Assigns elements, a view is never rebound
+            constexpr View &operator=(const View &other) { return operator= <View>(other); }
+            /// @brief In place when other is elementwise, the view then only reads itself at the element being written
+            template <typename _OTy>
+            constexpr View &operator+=(const _OTy &other)
+            {
+                if constexpr (IsInPlace<_OTy>())
+                    return AssignNoAlias(*this + other);
+                else
+                    return *this = *this + other;
+            }
+            template <typename _OTy>
+            constexpr View &operator-=(const _OTy &other)
             {
-                using ExprT = ExprStart<ExprSCalar<_Ty>>;
-                return BinaryOperator<DivideOperatorType, BinaryOperator<_BiFunc, _LExpr, _RExpr>, ExprT>(divOpt, *this, ExprT(rhs));
+                if constexpr (IsInPlace<_OTy>())
+                    return AssignNoAlias(*this - other);
+                else
+                    return *this = *this - other;
             }
+            template <arithmetic _OTy>
+            constexpr View &operator*=(const _OTy &other) { return AssignNoAlias(*this * other); }
+            template <arithmetic _OTy>
+            constexpr View &operator/=(const _OTy &other) { return AssignNoAlias(*this / other); }
+            /// @brief Assign or accumulate straight into the viewed storage, e.g. P.Block<3, 3>(0, 3).NoAlias() += F * Q
+            constexpr NoAliasProxy<View> NoAlias() { return NoAliasProxy<View>(*this); }
+#pragma endregion
         };
+
+        /// @brief A product operand as an expression node, storage is wrapped in ExprStart
+        template <typename _Ty>
+        constexpr auto ProductOperand(const _Ty &operand)
+        {
+            if constexpr (expression<_Ty>)
+                return operand;
+            else
+                return ExprStart<_Ty>(operand);
+        }
+    }
+
+    /// @brief lhs * rhs as a lazy product whose dot products accumulate as _Acc says, e.g.
+    /// P.NoAlias() = Product<Accumulation::Double>(F, P) keeps a float covariance update summed in double.
+    /// Small fixed shapes give up the unrolled kernel for it.
+    template <Accumulation _Acc, typename _LHS, typename _RHS>
+    constexpr auto Product(const _LHS &lhs, const _RHS &rhs)
+    {
+        lazy::CheckProductSize(lhs, rhs);
+        using LExpr = decltype(lazy::ProductOperand(lhs));
+        using RExpr = decltype(lazy::ProductOperand(rhs));
+        return lazy::ProductExpr<LExpr, RExpr, _Acc>(lazy::ProductOperand(lhs), lazy::ProductOperand(rhs));
     }
 }
@@ -6,126 +6,299 @@
 
 namespace LinerAlgebra
 {
-#define _MAT Matrix<_Row, _Col, _Ty>
-#define _BASE Base<Matrix, _Row, _Col, _Ty>
+#define _MAT Matrix<_Row, _Col, _Ty, _Alloc>
+#define _BASE Base<Matrix, _Row, _Col, _Ty, _Alloc>
 
-    template <size_t _Row, size_t _Col, typename _Ty = double>
-    class Matrix : public Base<Matrix, _Row, _Col, _Ty>
+    /// @brief Assignment target returned by Matrix::NoAlias(), the right-hand side is promised not to read the target
+    template <typename _Mat>
+    class NoAliasProxy
+    {
+        _Mat &mat;
+
+    public:
+        constexpr explicit NoAliasProxy(_Mat &mat) : mat(mat) {}
+        template <lazy::expression _Expr>
+        constexpr _Mat &operator=(const _Expr &expr) { return mat.AssignNoAlias(expr); }
+        template <lazy::expression _Expr>
+        constexpr _Mat &operator+=(const _Expr &expr) { return Accumulate(expr, 1); }
+        template <lazy::expression _Expr>
+        constexpr _Mat &operator-=(const _Expr &expr) { return Accumulate(expr, -1); }
+
+    private:
+        template <typename _Expr>
+        constexpr _Mat &Accumulate(const _Expr &expr, int sign)
+        {
+            using ValueType = typename _Mat::ValueType;
+            lazy::CheckSameSize(mat, expr);
+            // products accumulate inside GEMM (beta = 1) instead of going through their cache
+            if constexpr (lazy::matrix<_Mat> && requires(ValueType *dst) { expr.EvaluateTo(dst, ValueType(1), ValueType(1)); })
+            {
+                expr.EvaluateTo(mat.Data(), ValueType(sign), ValueType(1));
+                instrument::RecordEvaluation<_Expr>(mat.Row() * mat.Col());
+                return mat;
+            }
+            else if constexpr (requires(kernel::StridedRef<ValueType> dst) { mat.Target(); expr.EvaluateTo(dst, ValueType(1), ValueType(1)); })
+            {
+                expr.EvaluateTo(mat.Target(), ValueType(sign), ValueType(1));
+                instrument::RecordEvaluation<_Expr>(mat.Row() * mat.Col());
+                return mat;
+            }
+            else if (sign > 0)
+                return mat.AssignNoAlias(mat + expr);
+            else
+                return mat.AssignNoAlias(mat - expr);
+        }
+    };
+
+    /// @brief Dense row-major matrix, on the stack when small and fixed, otherwise in a vector using _Alloc
+    template <size_t _Row, size_t _Col, typename _Ty = double, typename _Alloc = std::allocator<_Ty>>
+    class Matrix : public _BASE
     {
     public:
-        ~Matrix() { std::cout << "DeConstructor!"; }
         static_assert((_Row != 0 && _Col != 0) || (_Row == 0 && _Col == 0), "Parameters only none zero or both zero");
-        using StorageType = decltype(Base<Matrix, _Row, _Col, _Ty>::elements);
-        using ValueType = typename _Ty;
-        using MatrixType = typename _MAT;
-        constexpr size_t Row() const noexcept { return _BASE::row; }
-        constexpr size_t Col() const noexcept { return _BASE::col; }
+        using StorageType = typename _BASE::StorageType;
+        using AllocatorType = _Alloc;
+        using ValueType = _Ty;
+        using MatrixType = _MAT;
+        static constexpr size_t RowsAtCompileTime = _Row;
+        static constexpr size_t ColsAtCompileTime = _Col;
+        constexpr size_t Row() const noexcept { return lazy::Extent<_Row>(_BASE::row); }
+        constexpr size_t Col() const noexcept { return lazy::Extent<_Col>(_BASE::col); }
         constexpr size_t Capacity() const noexcept;
         constexpr size_t Size() const noexcept { return this->elements.size(); }
-        Matrix() : Base<Matrix, _Row, _Col, _Ty>() {}
-        Matrix(size_t row, size_t col) : Base<Matrix, _Row, _Col, _Ty>(row, col) {}
-        Matrix(std::initializer_list<std::initializer_list<_Ty>> list);
+        constexpr _Ty *Data() noexcept { return this->elements.data(); }
+        constexpr const _Ty *Data() const noexcept { return this->elements.data(); }
+        constexpr Matrix() : _BASE() {}
+        constexpr Matrix(size_t row, size_t col) : _BASE(row, col) {}
+        constexpr Matrix(std::initializer_list<std::initializer_list<_Ty>> list);
+        /// @brief Copy of a matrix of the same shape kept by another allocator, e.g. a SmallDMatrix from a DMatrix
+        template <typename _OAlloc>
+            requires(!std::is_same_v<_OAlloc, _Alloc>)
+        constexpr Matrix(const Matrix<_Row, _Col, _Ty, _OAlloc> &other) : Matrix(other.Row(), other.Col())
+        {
+            std::copy_n(other.Data(), other.Size(), Data());
+        }
+
+#pragma region "Views"
+        /// @brief _R x _C block at (row, col), a zero-copy window that reads and writes this matrix
+        template <size_t _R, size_t _C>
+        constexpr auto Block(size_t row, size_t col) { return MakeView<_R, _C>(Data(), row, col, _R, _C); }
+        template <size_t _R, size_t _C>
+        constexpr auto Block(size_t row, size_t col) const { return MakeView<_R, _C>(Data(), row, col, _R, _C); }
+        constexpr auto Block(size_t row, size_t col, size_t rows, size_t cols) { return MakeView<Dynamic, Dynamic>(Data(), row, col, rows, cols); }
+        constexpr auto Block(size_t row, size_t col, size_t rows, size_t cols) const { return MakeView<Dynamic, Dynamic>(Data(), row, col, rows, cols); }
+        /// @brief The row-th row as a 1 x Col() view
+        constexpr auto Row(size_t row) { return MakeView<1, _Col>(Data(), row, 0, 1, Col()); }
+        constexpr auto Row(size_t row) const { return MakeView<1, _Col>(Data(), row, 0, 1, Col()); }
+        /// @brief The col-th column as a Row() x 1 view
+        constexpr auto Col(size_t col) { return MakeView<_Row, 1>(Data(), 0, col, Row(), 1); }
+        constexpr auto Col(size_t col) const { return MakeView<_Row, 1>(Data(), 0, col, Row(), 1); }
+        /// @brief Main diagonal as a column view with stride Col() + 1
+        constexpr auto Diagonal() { return lazy::View<_Ty, std::min(_Row, _Col), 1>({Data(), Col() + 1, 1}, std::min(Row(), Col()), 1); }
+        constexpr auto Diagonal() const { return lazy::View<const _Ty, std::min(_Row, _Col), 1>({Data(), Col() + 1, 1}, std::min(Row(), Col()), 1); }
+        /// @brief Lazy transpose: a read-only view with swapped strides, products consume it without a copy
+        constexpr auto Transpose() const { return lazy::View<const _Ty, _Col, _Row>({Data(), 1, Col()}, Col(), Row()); }
+#pragma endregion
 
 #pragma region "Operator overloading"
-        _Ty &operator()(size_t row, size_t col)
+        constexpr _Ty &operator()(size_t row, size_t col)
         {
             return *(this->elements.begin() + (row * Col() + col));
         }
-        const _Ty operator()(size_t row, size_t col) const { return this->elements[row * Col() + col]; }
-        _Ty &operator[](size_t index) { return *(this->elements.begin() + index); }
-        const _Ty operator[](size_t index) const { return this->elements[index]; }
-        template <lazy::arithmetic _Ty>
-        auto operator+(const _Ty &other) const
+        constexpr const _Ty operator()(size_t row, size_t col) const { return this->elements[row * Col() + col]; }
+        constexpr _Ty &operator[](size_t index) { return *(this->elements.begin() + index); }
+        constexpr const _Ty operator[](size_t index) const { return this->elements[index]; }
+        template <lazy::arithmetic _OTy>
+        constexpr auto operator+(const _OTy &other) const
         {
             using namespace lazy;
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<ExprScalar<_Ty>>;
+            using ExprT2 = ExprStart<ExprScalar<ScalarType<_Ty, _OTy>>>;
             return BinaryOperator<AddOperatorType, ExprT1, ExprT2>(addOpt, ExprT1(*this), ExprT2(other));
         }
-        template <lazy::expression _Ty>
-        auto operator+(const _Ty &other) const
+        template <lazy::expression _OTy>
+        constexpr auto operator+(const _OTy &other) const
         {
             using namespace lazy;
+            CheckSameSize(*this, other);
             using ExprT = ExprStart<Matrix>;
-            return BinaryOperator<AddOperatorType, ExprT, _Ty>(addOpt, ExprT(*this), other);
+            return BinaryOperator<AddOperatorType, ExprT, _OTy>(addOpt, ExprT(*this), other);
         }
-        template <_TMP class _T, size_t _Row, size_t _Col, typename _Ty>
-        auto operator+(const _T<_Row, _Col, _Ty> &other) const
+        template <lazy::leaf _OTy>
+        constexpr auto operator+(const _OTy &other) const
         {
-            if (!IsSizeMatch(other))
-                throw SizeExcept();
             using namespace lazy;
+            CheckSameSize(*this, other);
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<_T<_Row, _Col, _Ty>>;
+            using ExprT2 = ExprStart<_OTy>;
             return BinaryOperator<AddOperatorType, ExprT1, ExprT2>(addOpt, ExprT1(*this), ExprT2(other));
         }
-        template <lazy::arithmetic _Ty>
-        auto operator-(const _Ty &other) const
+        template <lazy::arithmetic _OTy>
+        constexpr auto operator-(const _OTy &other) const
         {
             using namespace lazy;
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<ExprScalar<_Ty>>;
+            using ExprT2 = ExprStart<ExprScalar<ScalarType<_Ty, _OTy>>>;
             return BinaryOperator<SubtractOperatorType, ExprT1, ExprT2>(subOpt, ExprT1(*this), ExprT2(other));
         }
-        template <lazy::expression _Ty>
-        auto operator-(const _Ty &other) const
+        template <lazy::expression _OTy>
+        constexpr auto operator-(const _OTy &other) const
         {
             using namespace lazy;
+            CheckSameSize(*this, other);
             using ExprT = ExprStart<Matrix>;
-            return BinaryOperator<SubtractOperatorType, ExprT, _Ty>(subOpt, ExprT(*this), other);
+            return BinaryOperator<SubtractOperatorType, ExprT, _OTy>(subOpt, ExprT(*this), other);
         }
-        template <_TMP class _T, size_t _Row, size_t _Col, typename _Ty>
-        auto operator-(const _T<_Row, _Col, _Ty> &other) const
+        template <lazy::leaf _OTy>
+        constexpr auto operator-(const _OTy &other) const
         {
-            if (!IsSizeMatch(other))
-                throw SizeExcept();
             using namespace lazy;
+            CheckSameSize(*this, other);
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<_T<_Row, _Col, _Ty>>;
+            using ExprT2 = ExprStart<_OTy>;
             return BinaryOperator<SubtractOperatorType, ExprT1, ExprT2>(subOpt, ExprT1(*this), ExprT2(other));
         }
-        template <lazy::arithmetic _Ty>
-        auto operator*(const _Ty &other) const
+        template <lazy::expression _OTy>
+        constexpr auto operator*(const _OTy &other) const
+        {
+            using namespace lazy;
+            CheckProductSize(*this, other);
+            using ExprT = ExprStart<Matrix>;
+            return ProductExpr<ExprT, _OTy>(ExprT(*this), other);
+        }
+        template <lazy::leaf _OTy>
+        constexpr auto operator*(const _OTy &other) const
+        {
+            using namespace lazy;
+            CheckProductSize(*this, other);
+            using ExprT1 = ExprStart<Matrix>;
+            using ExprT2 = ExprStart<_OTy>;
+            return ProductExpr<ExprT1, ExprT2>(ExprT1(*this), ExprT2(other));
+        }
+        template <lazy::arithmetic _OTy>
+        constexpr auto operator*(const _OTy &other) const
         {
             using namespace lazy;
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<ExprScalar<_Ty>>;
+            using ExprT2 = ExprStart<ExprScalar<ScalarType<_Ty, _OTy>>>;
             return BinaryOperator<MultipleOperatorType, ExprT1, ExprT2>(mulOpt, ExprT1(*this), ExprT2(other));
         }
-        template <lazy::arithmetic _Ty>
-        auto operator/(const _Ty &other) const
+        template <lazy::arithmetic _OTy>
+        constexpr auto operator/(const _OTy &other) const
         {
             using namespace lazy;
             using ExprT1 = ExprStart<Matrix>;
-            using ExprT2 = ExprStart<ExprScalar<_Ty>>;
+            using ExprT2 = ExprStart<ExprScalar<ScalarType<_Ty, _OTy>>>;
             return BinaryOperator<DivideOperatorType, ExprT1, ExprT2>(divOpt, ExprT1(*this), ExprT2(other));
         }
 #pragma endregion
 
+#pragma region "Assignment"
+        /// @brief Evaluate an expression into this matrix, reusing its storage when the expression is elementwise.
+        /// Anything else (products) may read this matrix while it is written and goes through a temporary,
+        /// use NoAlias() to skip it.
+        template <lazy::expression _Expr>
+        constexpr Matrix &operator=(const _Expr &expr)
+        {
+            if constexpr (_Expr::IsElementwise)
+                return AssignNoAlias(expr);
+            else
+            {
+                Matrix res = static_cast<Matrix>(expr);
+                instrument::RecordTemporary<_Expr>();
+                return *this = std::move(res);
+            }
+        }
+        template <lazy::leaf _OTy>
+            requires(!std::is_same_v<_OTy, Matrix>)
+        constexpr Matrix &operator=(const _OTy &other)
+        {
+            return AssignNoAlias(lazy::ExprStart<_OTy>(other));
+        }
+        template <typename _OTy>
+        constexpr Matrix &operator+=(const _OTy &other) { return *this = *this + other; }
+        template <typename _OTy>
+        constexpr Matrix &operator-=(const _OTy &other) { return *this = *this - other; }
+        template <typename _OTy>
+        constexpr Matrix &operator*=(const _OTy &other) { return *this = *this * other; }
+        template <lazy::arithmetic _OTy>
+        constexpr Matrix &operator/=(const _OTy &other) { return *this = *this / other; }
+        /// @brief Assign or accumulate straight into this storage, e.g. P.NoAlias() += F * Q
+        constexpr NoAliasProxy<Matrix> NoAlias() { return NoAliasProxy<Matrix>(*this); }
+#pragma endregion
+
+#pragma region "Reductions"
+        /// @brief Sum of all elements, in double or compensated through _Acc
+        template <Accumulation _Acc = Accumulation::Native>
+        constexpr auto Sum() const { return lazy::ExprStart<Matrix>(*this).template Sum<_Acc>(); }
+        /// @brief Sum of squared elements
+        template <Accumulation _Acc = Accumulation::Native>
+        constexpr auto SquaredNorm() const { return lazy::ExprStart<Matrix>(*this).template SquaredNorm<_Acc>(); }
+        /// @brief Frobenius norm, the Euclidean norm of a vector
+        template <Accumulation _Acc = Accumulation::Native>
+        auto Norm() const { return lazy::ExprStart<Matrix>(*this).template Norm<_Acc>(); }
+        /// @brief Largest absolute element
+        constexpr _Ty MaxAbs() const { return lazy::ExprStart<Matrix>(*this).MaxAbs(); }
+        /// @brief Sum of the main diagonal
+        constexpr _Ty Trace() const { return lazy::ExprStart<Matrix>(*this).Trace(); }
+        /// @brief Frobenius inner product with a matrix or expression of the same shape, e.g. v.Dot(S * v)
+        template <Accumulation _Acc = Accumulation::Native, typename _OTy>
+        constexpr auto Dot(const _OTy &other) const { return lazy::ExprStart<Matrix>(*this).template Dot<_Acc>(other); }
+#pragma endregion
+
         constexpr Matrix &Resize(size_t row, size_t col);
         constexpr void Reserve(size_t row, size_t col);
-        template <_TMP class _T, size_t _Row, size_t _Col, typename _Ty>
-        bool IsSizeMatch(const _T<_Row, _Col, _Ty> &other) const noexcept { return Row() == other.Row() && Col() == other.Col(); }
+        template <typename _Other>
+        bool IsSizeMatch(const _Other &other) const noexcept { return Row() == other.Row() && Col() == other.Col(); }
 
-        static Matrix Identity();
+        constexpr Matrix &TransposeInPlace();
+        constexpr Matrix Inverse() const;
+
+        constexpr static Matrix Identity();
         static Matrix Identity(size_t rank);
         static Matrix Random();
         static Matrix Random(size_t row, size_t col);
+
+    private:
+        template <size_t _R, size_t _C, typename _ETy>
+        constexpr lazy::View<_ETy, _R, _C> MakeView(_ETy *data, size_t row, size_t col, size_t rows, size_t cols) const
+        {
+            if (row + rows > Row() || col + cols > Col())
+                throw SizeExcept();
+            return lazy::View<_ETy, _R, _C>({data + row * Col() + col, Col(), 1}, rows, cols);
+        }
+        friend class NoAliasProxy<Matrix>;
+        template <typename _Expr>
+        constexpr Matrix &AssignNoAlias(const _Expr &expr);
     };
 
-    template <lazy::arithmetic _Num, size_t _Row, size_t _Col, typename _Ty>
-    auto operator*(const _Num& num, const Matrix<_Row, _Col, _Ty> &mat)
+    template <lazy::arithmetic _Num, size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    constexpr auto operator*(const _Num& num, const _MAT &mat)
     {
         return mat * num;
     }
 
+    template <typename _Ty = double, typename _Alloc = std::allocator<_Ty>>
+    using DMatrix = Matrix<Dynamic, Dynamic, _Ty, _Alloc>;
+
+    /// @brief Dynamic matrix whose storage comes from the thread-local memory::Arena
     template <typename _Ty = double>
-    using DMatrix = Matrix<Dynamic, Dynamic, _Ty>;
+    using ArenaDMatrix = DMatrix<_Ty, memory::ArenaAllocator<_Ty>>;
+
+    /// @brief Dynamic matrix holding up to _N elements inside the object, e.g. a measurement Jacobian whose
+    /// row count varies per epoch. Only a shape larger than _N allocates, from _Alloc.
+    template <size_t _N, typename _Ty = double, typename _Alloc = std::allocator<_Ty>>
+    using SmallDMatrix = DMatrix<_Ty, memory::InlineAllocator<_Ty, _N, _Alloc>>;
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline Matrix<_Row, _Col, _Ty>::Matrix(std::initializer_list<std::initializer_list<_Ty>> list)
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline constexpr _MAT::Matrix(std::initializer_list<std::initializer_list<_Ty>> list)
         : Matrix(list.size(), list.begin()->size())
     {
+        if constexpr (!_MAT::IsDynamic())
+        {
+            if (list.size() != _Row || list.begin()->size() != _Col)
+                throw SizeExcept();
+        }
         for (size_t i = 0; i < list.size(); ++i)
         {
             for (size_t j = 0; j < list.begin()->size(); ++j)
@@ -135,7 +308,7 @@ namespace LinerAlgebra
         }
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
     inline constexpr size_t _MAT::Capacity() const noexcept
     {
         if constexpr (_MAT::IsDynamic())
@@ -144,8 +317,8 @@ namespace LinerAlgebra
             return this->elements.size();
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline constexpr Matrix<_Row, _Col, _Ty> &_MAT::Resize(size_t row, size_t col)
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline constexpr _MAT &_MAT::Resize(size_t row, size_t col)
     {
         if constexpr (_MAT::IsDynamic())
         {
@@ -158,21 +331,69 @@ namespace LinerAlgebra
             return *this;
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
     inline constexpr void _MAT::Reserve(size_t row, size_t col)
     {
         if constexpr (_MAT::IsDynamic())
             this->elements.reserve(row * col);
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline Matrix<_Row, _Col, _Ty> _MAT::Identity()
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    template <typename _Expr>
+    inline constexpr _MAT &_MAT::AssignNoAlias(const _Expr &expr)
+    {
+        // Resize keeps the capacity, so repeated assignments of the same shape never allocate
+        if constexpr (_MAT::IsDynamic())
+            Resize(expr.Row(), expr.Col());
+        else
+            lazy::CheckSameSize(*this, expr);
+        expr.EvaluateTo(Data());
+        instrument::RecordEvaluation<_Expr>(Size());
+        return *this;
+    }
+
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline constexpr _MAT &_MAT::TransposeInPlace()
+    {
+        static_assert(_Row == _Col, "不是方阵!");
+        if constexpr (kernel::Unrollable(_Row, _Col))
+        {
+            const _MAT src = *this;
+            kernel::FixedTranspose<_Row, _Col>(src.Data(), Data());
+        }
+        else
+        {
+            // a rectangular matrix has nowhere to swap into, the tiled copy goes through a temporary
+            if (Row() != Col())
+                return *this = Transpose();
+            kernel::TransposeSquare(Row(), Data());
+        }
+        return *this;
+    }
+
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline constexpr _MAT _MAT::Inverse() const
+    {
+        static_assert(_Row == _Col, "不是方阵!");
+        static_assert(kernel::Unrollable(_Row, _Col), "Inverse is only available for fixed sizes up to 16, use LU(m).Inverse()");
+        _MAT res;
+        kernel::FixedInverse<_Row>(Data(), res.Data());
+        return res;
+    }
+
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline constexpr _MAT _MAT::Identity()
     {
         if constexpr (!_MAT::IsDynamic())
         {
             if constexpr (_Row != _Col)
                 throw "不是方阵!";
-            Matrix<_Row, _Col, _Ty> res;
+            _MAT res;
+            if constexpr (kernel::Unrollable(_Row, _Col))
+            {
+                kernel::FixedIdentity<_Row>(res.Data());
+                return res;
+            }
             for (size_t i = 0; i < res.row; ++i)
             {
                 for (size_t j = 0; j < res.col; ++j)
@@ -183,15 +404,15 @@ namespace LinerAlgebra
             return res;
         }
         else
-            return Matrix<_Row, _Col, _Ty>();
+            return _MAT();
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline Matrix<_Row, _Col, _Ty> _MAT::Identity(size_t rank)
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline _MAT _MAT::Identity(size_t rank)
     {
         if constexpr (_MAT::IsDynamic())
         {
-            Matrix<_Row, _Col, _Ty> res(rank, rank);
+            _MAT res(rank, rank);
             for (size_t i = 0; i < res.row; ++i)
             {
                 for (size_t j = 0; j < res.col; ++j)
@@ -205,32 +426,32 @@ namespace LinerAlgebra
             return _MAT::Identity();
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline Matrix<_Row, _Col, _Ty> _MAT::Random()
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline _MAT _MAT::Random()
     {
         if constexpr (!_MAT::IsDynamic())
         {
             std::random_device rd;
             std::mt19937 mt(rd());
             std::uniform_real_distribution<_Ty> dist(0.0, 1.0);
-            Matrix<_Row, _Col, _Ty> res;
+            _MAT res;
             std::ranges::for_each(res.elements, [&](_Ty &t)
                                   { t = dist(mt); });
             return res;
         }
         else
-            return Matrix<_Row, _Col, _Ty>();
+            return _MAT();
     }
 
-    template <size_t _Row, size_t _Col, typename _Ty>
-    inline Matrix<_Row, _Col, _Ty> _MAT::Random(size_t row, size_t col)
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    inline _MAT _MAT::Random(size_t row, size_t col)
     {
         if constexpr (_MAT::IsDynamic())
         {
             std::random_device rd;
             std::mt19937 mt(rd());
             std::uniform_real_distribution<_Ty> dist(0.0, 1.0);
-            Matrix<_Row, _Col, _Ty> res(row, col);
+            _MAT res(row, col);
             std::ranges::for_each(res.elements, [&](_Ty &t)
                                   { t = dist(mt); });
             return res;
@@ -240,23 +461,5 @@ namespace LinerAlgebra
     }
 }
 
-namespace std
-{
-    template <size_t _Row, size_t _Col, typename _Ty>
-    struct formatter<LinerAlgebra::Matrix<_Row, _Col, _Ty>> : formatter<_Ty>
-    {
-        auto format(const LinerAlgebra::Matrix<_Row, _Col, _Ty> &matrix, format_context &ctx)
-        {
-            for (size_t i = 0; i < matrix.Row(); ++i)
-            {
-                for (size_t j = 0; j < matrix.Col(); ++j)
-                {
-                    formatter<_Ty>::format(matrix(i, j), ctx);
-                    format_to(ctx.out(), " ");
-                }
-                format_to(ctx.out(), "\n");
-            }
-            return ctx.out();
-        }
-    };
-}
+// text formatting, including the std::formatter of Matrix
+#include "MatrixText.hpp"
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <type_traits>
+#include "Matrix.hpp"
+#include "Decomposition.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+#pragma region "Lane operations"
+        /// @brief Arithmetic on a packet of consecutive batch lanes
+        template <typename _Ty>
+        struct PacketLanes
+        {
+            using ValueType = _Ty;
+            using Type = simd::Packet<_Ty>;
+            static constexpr size_t Width = Type::Size;
+            static Type Load(const _Ty *ptr) { return simd::Load(ptr); }
+            static void Store(_Ty *ptr, const Type &value) { simd::Store(ptr, value); }
+            static Type Set1(_Ty value) { return simd::Set1(value); }
+            static Type Add(const Type &a, const Type &b) { return simd::Add(a, b); }
+            static Type Sub(const Type &a, const Type &b) { return simd::Sub(a, b); }
+            static Type Mul(const Type &a, const Type &b) { return simd::Mul(a, b); }
+            static Type Div(const Type &a, const Type &b) { return simd::Div(a, b); }
+            static Type Sqrt(const Type &a) { return simd::Sqrt(a); }
+        };
+
+        /// @brief The same operations on a single lane, for the tail of a batch
+        template <typename _Ty>
+        struct ScalarLanes
+        {
+            using ValueType = _Ty;
+            using Type = _Ty;
+            static constexpr size_t Width = 1;
+            static Type Load(const _Ty *ptr) { return *ptr; }
+            static void Store(_Ty *ptr, const Type &value) { *ptr = value; }
+            static Type Set1(_Ty value) { return value; }
+            static Type Add(const Type &a, const Type &b) { return a + b; }
+            static Type Sub(const Type &a, const Type &b) { return a - b; }
+            static Type Mul(const Type &a, const Type &b) { return a * b; }
+            static Type Div(const Type &a, const Type &b) { return a / b; }
+            static Type Sqrt(const Type &a) { return std::sqrt(a); }
+        };
+
+        /// @brief body(lane, ops) for every group of lanes in [0, _N): a packet at a time, then one lane at a time.
+        /// ops is PacketLanes or ScalarLanes, so one generic body serves both.
+        template <size_t _N, typename _Ty, typename _Body>
+        inline void ForEachLane(_Body &&body)
+        {
+            constexpr size_t width = simd::Packet<_Ty>::Size;
+            size_t lane = 0;
+            if constexpr (width > 1)
+                for (; lane + width <= _N; lane += width)
+                    body(lane, PacketLanes<_Ty>{});
+            // a one-wide packet skips the packet loop, so every lane runs through the tail
+            if constexpr (width == 1 || _N % width != 0)
+                for (; lane < _N; ++lane)
+                    body(lane, ScalarLanes<_Ty>{});
+        }
+
+        /// @brief Whether pred holds for any lane of value
+        template <typename _Ops, typename _Pred>
+        inline bool AnyLane(_Ops ops, const typename _Ops::Type &value, _Pred &&pred)
+        {
+            typename _Ops::ValueType lanes[_Ops::Width];
+            ops.Store(lanes, value);
+            return std::any_of(lanes, lanes + _Ops::Width, pred);
+        }
+#pragma endregion
+
+#pragma region "Batched kernels"
+        // Element (i, j) of every matrix in a _R x _C batch is the contiguous run data[(i * _C + j) * _N, + _N).
+
+        /// @brief c = a * b for each of the _N matrices, c must not alias a or b.
+        /// Each output element sweeps the whole batch, so only 2 * _K + 1 lane runs are streamed at a time.
+        template <size_t _R, size_t _K, size_t _C, size_t _N, typename _Ty>
+        inline void BatchProduct(const _Ty *a, const _Ty *b, _Ty *c)
+        {
+            for (size_t i = 0; i < _R; ++i)
+                for (size_t j = 0; j < _C; ++j)
+                    ForEachLane<_N, _Ty>([&](size_t lane, auto ops)
+                                         {
+                        auto acc = ops.Mul(ops.Load(a + i * _K * _N + lane), ops.Load(b + j * _N + lane));
+                        for (size_t p = 1; p < _K; ++p)
+                            acc = ops.Add(acc, ops.Mul(ops.Load(a + (i * _K + p) * _N + lane), ops.Load(b + (p * _C + j) * _N + lane)));
+                        ops.Store(c + (i * _C + j) * _N + lane, acc); });
+        }
+
+        /// @brief dst = src⁻¹ for each _M x _M matrix in closed form, _M up to 3
+        template <size_t _M, size_t _N, typename _Ty>
+        inline void BatchInverse(const _Ty *src, _Ty *dst)
+        {
+            static_assert(_M <= 3, "Closed form inverse is only available up to 3 x 3");
+            ForEachLane<_N, _Ty>([&](size_t lane, auto ops)
+                                 {
+                const auto s = [&](size_t index) { return ops.Load(src + index * _N + lane); };
+                const auto d = [&](size_t index, auto value) { ops.Store(dst + index * _N + lane, value); };
+                const auto checked = [&](auto det)
+                {
+                    if (AnyLane(ops, det, [](_Ty x) { return x == _Ty(0); }))
+                        throw SingularExcept();
+                    return ops.Div(ops.Set1(_Ty(1)), det);
+                };
+                if constexpr (_M == 1)
+                    d(0, checked(s(0)));
+                else if constexpr (_M == 2)
+                {
+                    const auto inv = checked(ops.Sub(ops.Mul(s(0), s(3)), ops.Mul(s(1), s(2))));
+                    const auto zero = ops.Set1(_Ty(0));
+                    d(0, ops.Mul(s(3), inv));
+                    d(1, ops.Sub(zero, ops.Mul(s(1), inv)));
+                    d(2, ops.Sub(zero, ops.Mul(s(2), inv)));
+                    d(3, ops.Mul(s(0), inv));
+                }
+                else
+                {
+                    const auto minor = [&](size_t a, size_t b, size_t c, size_t e) { return ops.Sub(ops.Mul(s(a), s(b)), ops.Mul(s(c), s(e))); };
+                    const auto c0 = minor(4, 8, 5, 7), c1 = minor(5, 6, 3, 8), c2 = minor(3, 7, 4, 6);
+                    const auto inv = checked(ops.Add(ops.Add(ops.Mul(s(0), c0), ops.Mul(s(1), c1)), ops.Mul(s(2), c2)));
+                    d(0, ops.Mul(c0, inv));
+                    d(1, ops.Mul(minor(2, 7, 1, 8), inv));
+                    d(2, ops.Mul(minor(1, 5, 2, 4), inv));
+                    d(3, ops.Mul(c1, inv));
+                    d(4, ops.Mul(minor(0, 8, 2, 6), inv));
+                    d(5, ops.Mul(minor(2, 3, 0, 5), inv));
+                    d(6, ops.Mul(c2, inv));
+                    d(7, ops.Mul(minor(1, 6, 0, 7), inv));
+                    d(8, ops.Mul(minor(0, 4, 1, 3), inv));
+                } });
+        }
+
+        /// @brief Overwrite the lower triangle of each _M x _M matrix with its Cholesky factor, the upper triangle is not touched
+        template <size_t _M, size_t _N, typename _Ty>
+        inline void BatchCholesky(_Ty *a)
+        {
+            ForEachLane<_N, _Ty>([&](size_t lane, auto ops)
+                                 {
+                const auto at = [&](size_t i, size_t j) { return a + (i * _M + j) * _N + lane; };
+                for (size_t j = 0; j < _M; ++j)
+                {
+                    auto diag = ops.Load(at(j, j));
+                    for (size_t k = 0; k < j; ++k)
+                        diag = ops.Sub(diag, ops.Mul(ops.Load(at(j, k)), ops.Load(at(j, k))));
+                    if (AnyLane(ops, diag, [](_Ty x) { return !(x > _Ty(0)); }))
+                        throw NotPositiveDefiniteExcept();
+                    const auto ljj = ops.Sqrt(diag);
+                    ops.Store(at(j, j), ljj);
+                    for (size_t i = j + 1; i < _M; ++i)
+                    {
+                        auto sum = ops.Load(at(i, j));
+                        for (size_t k = 0; k < j; ++k)
+                            sum = ops.Sub(sum, ops.Mul(ops.Load(at(i, k)), ops.Load(at(j, k))));
+                        ops.Store(at(i, j), ops.Div(sum, ljj));
+                    }
+                } });
+        }
+
+        /// @brief Overwrite each _M x _C right-hand side b with (L * Lᵀ)⁻¹ * b
+        template <size_t _M, size_t _C, size_t _N, typename _Ty>
+        inline void BatchCholeskySolve(const _Ty *l, _Ty *b)
+        {
+            ForEachLane<_N, _Ty>([&](size_t lane, auto ops)
+                                 {
+                const auto lAt = [&](size_t i, size_t j) { return ops.Load(l + (i * _M + j) * _N + lane); };
+                const auto bAt = [&](size_t i, size_t j) { return b + (i * _C + j) * _N + lane; };
+                for (size_t c = 0; c < _C; ++c)
+                {
+                    for (size_t i = 0; i < _M; ++i)
+                    {
+                        auto sum = ops.Load(bAt(i, c));
+                        for (size_t k = 0; k < i; ++k)
+                            sum = ops.Sub(sum, ops.Mul(lAt(i, k), ops.Load(bAt(k, c))));
+                        ops.Store(bAt(i, c), ops.Div(sum, lAt(i, i)));
+                    }
+                    for (size_t i = _M; i-- > 0;)
+                    {
+                        auto sum = ops.Load(bAt(i, c));
+                        for (size_t k = i + 1; k < _M; ++k)
+                            sum = ops.Sub(sum, ops.Mul(lAt(k, i), ops.Load(bAt(k, c))));
+                        ops.Store(bAt(i, c), ops.Div(sum, lAt(i, i)));
+                    }
+                } });
+        }
+#pragma endregion
+    }
+
+    /// @brief _N independent _Row x _Col matrices in structure-of-arrays layout. Element (i, j) of every matrix
+    /// is contiguous, so a packet holds the same element of several matrices and each kernel runs across the batch.
+    /// To the lazy expressions the batch is a (_Row * _Col) x _N leaf: +, -, scalar * and / stay lazy and fused,
+    /// products, Transpose, Inverse and Cholesky are the batched kernels above.
+    /// @tparam _N Number of matrices
+    template <size_t _Row, size_t _Col, size_t _N, typename _Ty = double>
+    class MatrixBatch
+    {
+    public:
+        static_assert(_Row != 0 && _Col != 0 && _N != 0, "Batch shapes are fixed");
+        using ValueType = _Ty;
+        using MatrixType = Matrix<_Row, _Col, _Ty>;
+        using StorageType = std::conditional_t<isLittle(_Row * _Col, _N), std::array<_Ty, _Row * _Col * _N>,
+                                               std::vector<_Ty, memory::AlignedAllocator<_Ty>>>;
+        static constexpr size_t Rows = _Row;
+        static constexpr size_t Cols = _Col;
+        static constexpr size_t BatchSize = _N;
+        static constexpr size_t RowsAtCompileTime = _Row * _Col;
+        static constexpr size_t ColsAtCompileTime = _N;
+
+    private:
+        StorageType elements{};
+
+        template <typename _Expr>
+        MatrixBatch &AssignNoAlias(const _Expr &expr)
+        {
+            lazy::CheckSameSize(*this, expr);
+            expr.EvaluateTo(Data());
+            return *this;
+        }
+
+    public:
+        MatrixBatch()
+        {
+            if constexpr (!IsInStack())
+                elements.resize(_Row * _Col * _N);
+        }
+        /// @brief Evaluate an elementwise expression of batches
+        template <lazy::expression _Expr>
+        MatrixBatch(const _Expr &expr) : MatrixBatch() { AssignNoAlias(expr); }
+
+        constexpr static bool IsInStack() { return isLittle(_Row * _Col, _N); }
+        /// @brief Flat leaf extents, one row per element and one column per matrix
+        constexpr size_t Row() const noexcept { return _Row * _Col; }
+        constexpr size_t Col() const noexcept { return _N; }
+        constexpr size_t Size() const noexcept { return _N; }
+        _Ty *Data() noexcept { return elements.data(); }
+        const _Ty *Data() const noexcept { return elements.data(); }
+
+        _Ty &operator[](size_t index) { return elements[index]; }
+        _Ty operator[](size_t index) const { return elements[index]; }
+        /// @brief Element (row, col) of matrix lane
+        _Ty &operator()(size_t row, size_t col, size_t lane) { return elements[(row * _Col + col) * _N + lane]; }
+        _Ty operator()(size_t row, size_t col, size_t lane) const { return elements[(row * _Col + col) * _N + lane]; }
+
+#pragma region "Conversion"
+        /// @brief Copy of matrix lane
+        MatrixType Get(size_t lane) const
+        {
+            MatrixType res;
+            for (size_t index = 0; index < _Row * _Col; ++index)
+                res[index] = elements[index * _N + lane];
+            return res;
+        }
+        /// @brief Overwrite matrix lane with mat
+        template <typename _Mat>
+        MatrixBatch &Set(size_t lane, const _Mat &mat)
+        {
+            const MatrixType &src = mat;
+            for (size_t index = 0; index < _Row * _Col; ++index)
+                elements[index * _N + lane] = src[index];
+            return *this;
+        }
+        /// @brief Every lane holds a copy of mat
+        template <typename _Mat>
+        static MatrixBatch Broadcast(const _Mat &mat)
+        {
+            const MatrixType &src = mat;
+            MatrixBatch res;
+            for (size_t index = 0; index < _Row * _Col; ++index)
+                std::fill_n(res.Data() + index * _N, _N, src[index]);
+            return res;
+        }
+        static MatrixBatch Identity() { return Broadcast(MatrixType::Identity()); }
+#pragma endregion
+
+#pragma region "Operator overloading"
+        template <lazy::arithmetic _OTy>
+        auto operator+(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) + other; }
+        template <typename _OTy>
+            requires lazy::expression<_OTy> || lazy::leaf<_OTy>
+        auto operator+(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) + other; }
+        template <lazy::arithmetic _OTy>
+        auto operator-(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) - other; }
+        template <typename _OTy>
+            requires lazy::expression<_OTy> || lazy::leaf<_OTy>
+        auto operator-(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) - other; }
+        template <lazy::arithmetic _OTy>
+        auto operator*(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) * other; }
+        template <lazy::arithmetic _OTy>
+        auto operator/(const _OTy &other) const { return lazy::ExprStart<MatrixBatch>(*this) / other; }
+        /// @brief Batched product, matrix k of the result is matrix k of this times matrix k of other
+        template <size_t _K>
+        MatrixBatch<_Row, _K, _N, _Ty> operator*(const MatrixBatch<_Col, _K, _N, _Ty> &other) const
+        {
+            MatrixBatch<_Row, _K, _N, _Ty> res;
+            kernel::BatchProduct<_Row, _Col, _K, _N>(Data(), other.Data(), res.Data());
+            return res;
+        }
+#pragma endregion
+
+#pragma region "Assignment"
+        /// @brief Every batch expression is elementwise, so it is evaluated straight into this storage
+        template <lazy::expression _Expr>
+        MatrixBatch &operator=(const _Expr &expr) { return AssignNoAlias(expr); }
+        template <typename _OTy>
+        MatrixBatch &operator+=(const _OTy &other) { return AssignNoAlias(*this + other); }
+        template <typename _OTy>
+        MatrixBatch &operator-=(const _OTy &other) { return AssignNoAlias(*this - other); }
+        template <lazy::arithmetic _OTy>
+        MatrixBatch &operator*=(const _OTy &other) { return AssignNoAlias(*this * other); }
+        template <lazy::arithmetic _OTy>
+        MatrixBatch &operator/=(const _OTy &other) { return AssignNoAlias(*this / other); }
+#pragma endregion
+
+        MatrixBatch<_Col, _Row, _N, _Ty> Transpose() const
+        {
+            MatrixBatch<_Col, _Row, _N, _Ty> res;
+            for (size_t i = 0; i < _Row; ++i)
+                for (size_t j = 0; j < _Col; ++j)
+                    std::copy_n(Data() + (i * _Col + j) * _N, _N, res.Data() + (j * _Row + i) * _N);
+            return res;
+        }
+
+        /// @brief Inverse of every matrix, vectorized in closed form up to 3 x 3 and one matrix at a time above
+        MatrixBatch Inverse() const
+        {
+            static_assert(_Row == _Col, "不是方阵!");
+            static_assert(kernel::Unrollable(_Row, _Col), "Inverse is only available for fixed sizes up to 16, use Cholesky");
+            MatrixBatch res;
+            if constexpr (_Row <= 3)
+                kernel::BatchInverse<_Row, _N>(Data(), res.Data());
+            else
+                for (size_t lane = 0; lane < _N; ++lane)
+                    res.Set(lane, Get(lane).Inverse());
+            return res;
+        }
+    };
+
+    /// @brief Cholesky factorization of every matrix in a batch, vectorized across the batch
+    template <size_t _M, size_t _N, typename _Ty>
+    class Cholesky<MatrixBatch<_M, _M, _N, _Ty>>
+    {
+        using BatchType = MatrixBatch<_M, _M, _N, _Ty>;
+        BatchType factor;
+
+    public:
+        using ValueType = _Ty;
+        static constexpr size_t RowsAtCompileTime = _M;
+
+        Cholesky() = default;
+        template <typename _OTy>
+        explicit Cholesky(const _OTy &a) { Compute(a); }
+
+        /// @brief Factor every matrix of a, NotPositiveDefiniteExcept when any of them is not positive definite
+        template <typename _OTy>
+        Cholesky &Compute(const _OTy &a)
+        {
+            factor = a;
+            kernel::BatchCholesky<_M, _N>(factor.Data());
+            return *this;
+        }
+
+        template <size_t _C>
+        void SolveInPlace(MatrixBatch<_M, _C, _N, _Ty> &b) const
+        {
+            kernel::BatchCholeskySolve<_M, _C, _N>(factor.Data(), b.Data());
+        }
+
+        template <size_t _C>
+        MatrixBatch<_M, _C, _N, _Ty> Solve(MatrixBatch<_M, _C, _N, _Ty> b) const
+        {
+            SolveInPlace(b);
+            return b;
+        }
+
+        BatchType MatrixL() const
+        {
+            BatchType l = factor;
+            for (size_t i = 0; i < _M; ++i)
+                for (size_t j = i + 1; j < _M; ++j)
+                    std::fill_n(l.Data() + (i * _M + j) * _N, _N, _Ty(0));
+            return l;
+        }
+    };
+}
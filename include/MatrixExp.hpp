@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <utility>
+#include "Matrix.hpp"
+#include "Decomposition.hpp"
+#include "Allocator.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+#pragma region "Matrix exponential kernels"
+        // All kernels work on n x n row-major arrays. _N is the compile-time order or Dynamic: fixed orders up to
+        // MaxUnroll multiply with the unrolled FixedProduct and factor with the unrolled LU panel, the rest use GEMM.
+
+        /// @brief Padé degrees tried in order and the largest 1-norm each is accurate for in double precision,
+        /// from Higham, "The scaling and squaring method for the matrix exponential revisited", 2005
+        inline constexpr std::array<size_t, 5> PadeDegrees{3, 5, 7, 9, 13};
+        inline constexpr std::array<double, 5> PadeTheta{1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+                                                         2.097847961257068e0, 5.371920351148152e0};
+
+        /// @brief Coefficients b0 ... bm of the degree m Padé approximant for each m in PadeDegrees
+        inline constexpr double Pade3[] = {120.0, 60.0, 12.0, 1.0};
+        inline constexpr double Pade5[] = {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0};
+        inline constexpr double Pade7[] = {17297280.0, 8648640.0, 1995840.0, 277200.0, 25200.0, 1512.0, 56.0, 1.0};
+        inline constexpr double Pade9[] = {17643225600.0, 8821612800.0, 2075673600.0, 302702400.0, 30270240.0,
+                                           2162160.0, 110880.0, 3960.0, 90.0, 1.0};
+        inline constexpr double Pade13[] = {64764752532480000.0, 32382376266240000.0, 7771770303897600.0,
+                                            1187353796428800.0, 129060195264000.0, 10559470521600.0,
+                                            670442572800.0, 33522128640.0, 1323241920.0, 40840800.0,
+                                            960960.0, 16380.0, 182.0, 1.0};
+        constexpr const double *PadeCoefficients(size_t degree)
+        {
+            return degree == 3 ? Pade3 : degree == 5 ? Pade5 : degree == 7 ? Pade7 : degree == 9 ? Pade9 : Pade13;
+        }
+
+        /// @brief Elements of scratch ExpPade needs for order n
+        constexpr size_t ExpPadeWork(size_t n) { return 8 * n * n; }
+
+        /// @brief Largest absolute column sum
+        template <typename _Ty>
+        _Ty Norm1(size_t n, const _Ty *a)
+        {
+            _Ty res(0);
+            for (size_t j = 0; j < n; ++j)
+            {
+                _Ty sum(0);
+                for (size_t i = 0; i < n; ++i)
+                    sum += Abs(a[i * n + j]);
+                res = std::max(res, sum);
+            }
+            return res;
+        }
+
+        /// @brief c = a * b, c must not alias a or b
+        template <size_t _N, typename _Ty>
+        void SquareProduct(size_t n, const _Ty *a, const _Ty *b, _Ty *c)
+        {
+            if constexpr (Unrollable(_N, _N))
+                FixedProduct<_N, _N, _N>(a, b, c);
+            else
+                Gemm<_Ty>(n, n, n, _Ty(1), {a, n, 1}, {b, n, 1}, _Ty(0), {c, n, 1});
+        }
+
+        /// @brief q = p⁻¹ * q with partial pivoting, p is overwritten by its LU factors
+        template <size_t _N, typename _Ty>
+        void SolveSquare(size_t n, _Ty *p, _Ty *q, size_t *pivots)
+        {
+            int sign;
+            LUBlocked<_N>(n, StridedRef<_Ty>{p, n, 1}, pivots, sign);
+            for (size_t i = 0; i < n; ++i)
+                if (pivots[i] != i)
+                    std::swap_ranges(q + i * n, q + i * n + n, q + pivots[i] * n);
+            TrsmLower<_Ty>(n, n, {p, n, 1}, {q, n, 1}, true);
+            TrsmUpper<_Ty>(n, n, {p, n, 1}, {q, n, 1});
+        }
+
+        /// @brief res = exp(a) by scaling and squaring: the lowest Padé degree accurate for ‖a‖₁ without scaling,
+        /// or degree 13 after dividing a by the power of two that brings it under PadeTheta[4]
+        /// @param work ExpPadeWork(n) elements
+        /// @param pivots n elements
+        template <size_t _N, typename _Ty>
+        void ExpPade(size_t n, const _Ty *a, _Ty *res, _Ty *work, size_t *pivots)
+        {
+            const size_t nn = n * n;
+            _Ty *as = work, *a2 = as + nn, *a4 = a2 + nn, *a6 = a4 + nn, *a8 = a6 + nn, *u = a8 + nn, *v = u + nn, *tmp = v + nn;
+            const _Ty norm = Norm1(n, a);
+            size_t degree = PadeDegrees[4];
+            for (size_t i = 0; i + 1 < PadeDegrees.size(); ++i)
+            {
+                if (norm <= _Ty(PadeTheta[i]))
+                {
+                    degree = PadeDegrees[i];
+                    break;
+                }
+            }
+            int squarings = 0;
+            if (degree == PadeDegrees[4] && norm > _Ty(PadeTheta[4]))
+                squarings = static_cast<int>(std::ceil(std::log2(norm / _Ty(PadeTheta[4]))));
+            const _Ty scale = std::ldexp(_Ty(1), -squarings);
+            for (size_t index = 0; index < nn; ++index)
+                as[index] = a[index] * scale;
+
+            const double *b = PadeCoefficients(degree);
+            // dst += c0 I + Σ coef * power
+            const auto accumulate = [&](_Ty *dst, _Ty c0, std::initializer_list<std::pair<_Ty, const _Ty *>> terms)
+            {
+                for (const auto &[coef, power] : terms)
+                    for (size_t index = 0; index < nn; ++index)
+                        dst[index] += coef * power[index];
+                for (size_t i = 0; i < n; ++i)
+                    dst[i * n + i] += c0;
+            };
+            SquareProduct<_N>(n, as, as, a2);
+            if (degree >= 5)
+                SquareProduct<_N>(n, a2, a2, a4);
+            if (degree >= 7)
+                SquareProduct<_N>(n, a4, a2, a6);
+            if (degree == 9)
+                SquareProduct<_N>(n, a4, a4, a8);
+            if (degree == 13)
+            {
+                // U = A [A6 (b13 A6 + b11 A4 + b9 A2) + b7 A6 + b5 A4 + b3 A2 + b1 I], V likewise with the even coefficients
+                std::fill_n(tmp, nn, _Ty(0));
+                accumulate(tmp, _Ty(0), {{_Ty(b[13]), a6}, {_Ty(b[11]), a4}, {_Ty(b[9]), a2}});
+                SquareProduct<_N>(n, a6, tmp, v);
+                accumulate(v, _Ty(b[1]), {{_Ty(b[7]), a6}, {_Ty(b[5]), a4}, {_Ty(b[3]), a2}});
+                SquareProduct<_N>(n, as, v, u);
+                std::fill_n(tmp, nn, _Ty(0));
+                accumulate(tmp, _Ty(0), {{_Ty(b[12]), a6}, {_Ty(b[10]), a4}, {_Ty(b[8]), a2}});
+                SquareProduct<_N>(n, a6, tmp, v);
+                accumulate(v, _Ty(b[0]), {{_Ty(b[6]), a6}, {_Ty(b[4]), a4}, {_Ty(b[2]), a2}});
+            }
+            else
+            {
+                const _Ty *powers[] = {a2, a4, a6, a8};
+                std::fill_n(tmp, nn, _Ty(0));
+                std::fill_n(v, nn, _Ty(0));
+                for (size_t k = 1; 2 * k <= degree; ++k)
+                {
+                    for (size_t index = 0; index < nn; ++index)
+                    {
+                        tmp[index] += _Ty(b[2 * k + 1]) * powers[k - 1][index];
+                        v[index] += _Ty(b[2 * k]) * powers[k - 1][index];
+                    }
+                }
+                for (size_t i = 0; i < n; ++i)
+                {
+                    tmp[i * n + i] += _Ty(b[1]);
+                    v[i * n + i] += _Ty(b[0]);
+                }
+                SquareProduct<_N>(n, as, tmp, u);
+            }
+            // (V - U) X = V + U
+            for (size_t index = 0; index < nn; ++index)
+            {
+                tmp[index] = v[index] - u[index];
+                res[index] = v[index] + u[index];
+            }
+            SolveSquare<_N>(n, tmp, res, pivots);
+            _Ty *cur = res, *next = tmp;
+            for (int s = 0; s < squarings; ++s)
+            {
+                SquareProduct<_N>(n, cur, cur, next);
+                std::swap(cur, next);
+            }
+            if (cur != res)
+                std::copy_n(cur, nn, res);
+        }
+
+        /// @brief res = I + a + a² / 2! + ... + a^order / order! by Horner's rule, order - 1 products and no solve
+        /// @param work n * n elements
+        template <size_t _N, typename _Ty>
+        void ExpTaylor(size_t n, const _Ty *a, size_t order, _Ty *res, _Ty *work)
+        {
+            const size_t nn = n * n;
+            // res = I + a / order, then res = I + a * res / j for j = order - 1 ... 1
+            const _Ty last = order == 0 ? _Ty(0) : _Ty(1) / _Ty(order);
+            for (size_t index = 0; index < nn; ++index)
+                res[index] = a[index] * last;
+            for (size_t i = 0; i < n; ++i)
+                res[i * n + i] += _Ty(1);
+            for (size_t j = order - (order != 0); j >= 1; --j)
+            {
+                SquareProduct<_N>(n, a, res, work);
+                const _Ty inv = _Ty(1) / _Ty(j);
+                for (size_t index = 0; index < nn; ++index)
+                    res[index] = work[index] * inv;
+                for (size_t i = 0; i < n; ++i)
+                    res[i * n + i] += _Ty(1);
+            }
+        }
+
+        /// @brief Φ = exp(a) and Qd = ∫ exp(a s) qc exp(aᵀ s) ds over the unit step, both to the given Taylor order.
+        /// With L(s) the integrand, L' = a L + L aᵀ, so term k + 1 of Qd is (a Eₖ + (a Eₖ)ᵀ) / (k + 1)!: one n x n
+        /// product per term instead of the exponential of the 2n x 2n Van Loan matrix, and Qd is symmetric by construction.
+        /// @param a F * dt
+        /// @param qc G * Q * Gᵀ * dt, symmetric
+        /// @param work 2 * n * n elements
+        template <size_t _N, typename _Ty>
+        void DiscretizeTaylor(size_t n, const _Ty *a, const _Ty *qc, size_t order, _Ty *phi, _Ty *qd, _Ty *work)
+        {
+            const size_t nn = n * n;
+            ExpTaylor<_N>(n, a, order, phi, work);
+            _Ty *term = work, *product = work + nn;
+            std::copy_n(qc, nn, term);
+            std::copy_n(qc, nn, qd);
+            _Ty factorial(1);
+            for (size_t k = 1; k < order; ++k)
+            {
+                SquareProduct<_N>(n, a, term, product);
+                factorial *= _Ty(k + 1);
+                const _Ty inv = _Ty(1) / factorial;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    for (size_t j = i; j < n; ++j)
+                    {
+                        const _Ty value = product[i * n + j] + product[j * n + i];
+                        term[i * n + j] = term[j * n + i] = value;
+                        qd[i * n + j] += value * inv;
+                        if (j != i)
+                            qd[j * n + i] = qd[i * n + j];
+                    }
+                }
+            }
+        }
+
+        /// @brief Van Loan: exp([-a, qc; 0, aᵀ]) = [., Φ⁻¹ Qd; 0, Φᵀ], so Φ and Qd come out of one 2n x 2n exponential
+        /// @param a F * dt
+        /// @param qc G * Q * Gᵀ * dt
+        /// @param work 8 n² + ExpPadeWork(2 n) elements
+        /// @param pivots 2 n elements
+        template <size_t _N, typename _Ty>
+        void DiscretizeVanLoan(size_t n, const _Ty *a, const _Ty *qc, _Ty *phi, _Ty *qd, _Ty *work, size_t *pivots)
+        {
+            constexpr size_t order = lazy::IsFixed(_N) ? 2 * _N : Dynamic;
+            const size_t m = 2 * n;
+            _Ty *block = work, *e = work + m * m;
+            std::fill_n(block, m * m, _Ty(0));
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    block[i * m + j] = -a[i * n + j];
+                    block[i * m + n + j] = qc[i * n + j];
+                    block[(n + i) * m + n + j] = a[j * n + i];
+                }
+            }
+            ExpPade<order>(m, block, e, e + m * m, pivots);
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j)
+                    phi[i * n + j] = e[(n + j) * m + n + i];
+            // Qd = Φ * (Φ⁻¹ Qd), then the rounding in the product is split evenly between the two triangles
+            Gemm<_Ty>(n, n, n, _Ty(1), {phi, n, 1}, {e + n, m, 1}, _Ty(0), {qd, n, 1});
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = i + 1; j < n; ++j)
+                    qd[i * n + j] = qd[j * n + i] = _Ty(0.5) * (qd[i * n + j] + qd[j * n + i]);
+        }
+#pragma endregion
+    }
+
+    namespace detail
+    {
+        /// @brief A square matrix or expression evaluated into its own storage
+        template <typename _Mat>
+        auto EvaluateSquare(const _Mat &mat)
+        {
+            auto res = EvaluateRhs(mat);
+            using ResType = decltype(res);
+            static_assert(lazy::DimMatch(ResType::RowsAtCompileTime, ResType::ColsAtCompileTime), "不是方阵!");
+            if (res.Row() != res.Col())
+                throw SizeExcept();
+            return res;
+        }
+    }
+
+    /// @brief exp(a) to full precision by scaling and squaring with Padé approximants, for a matrix or expression
+    template <typename _Mat>
+    auto Exp(const _Mat &mat)
+    {
+        auto a = detail::EvaluateSquare(mat);
+        using ResType = decltype(a);
+        using ValueType = typename ResType::ValueType;
+        const size_t n = a.Row();
+        ResType res(n, n);
+        memory::ArenaScope scope;
+        lazy::ScratchBuffer<ValueType> work(kernel::ExpPadeWork(n));
+        lazy::ScratchBuffer<size_t> pivots(n);
+        kernel::ExpPade<ResType::RowsAtCompileTime>(n, a.Data(), res.Data(), work.data(), pivots.data());
+        return res;
+    }
+
+    /// @brief Low-order exp(a): the Taylor series up to a^order / order!, order - 1 products and no solve.
+    /// For steps so short that the truncation error of about ‖a‖^(order + 1) / (order + 1)! is acceptable;
+    /// nothing checks it, Exp() is the accurate choice for any a.
+    template <typename _Mat>
+    auto ExpTaylor(const _Mat &mat, size_t order)
+    {
+        auto a = detail::EvaluateSquare(mat);
+        using ResType = decltype(a);
+        using ValueType = typename ResType::ValueType;
+        const size_t n = a.Row();
+        ResType res(n, n);
+        memory::ArenaScope scope;
+        lazy::ScratchBuffer<ValueType> work(n * n);
+        kernel::ExpTaylor<ResType::RowsAtCompileTime>(n, a.Data(), order, res.Data(), work.data());
+        return res;
+    }
+
+    /// @brief Discrete transition matrix and process noise of ẋ = F x + G w, E[w wᵀ] = Q δ(t)
+    template <typename _Mat>
+    struct Discretization
+    {
+        _Mat phi; // exp(F dt)
+        _Mat qd;  // ∫ Φ(s) G Q Gᵀ Φ(s)ᵀ ds over [0, dt], exactly symmetric
+    };
+
+    namespace detail
+    {
+        template <typename _F, typename _G, typename _Q, typename _Ty, typename _Kernel>
+        auto Discretize(const _F &f, const _G &g, const _Q &q, _Ty dt, size_t work, _Kernel &&kernel)
+        {
+            auto a = EvaluateSquare(f);
+            using MatrixType = decltype(a);
+            using ValueType = typename MatrixType::ValueType;
+            const size_t n = a.Row();
+            if (g.Row() != n || g.Col() != q.Row() || q.Row() != q.Col())
+                throw SizeExcept();
+            const ValueType step = static_cast<ValueType>(dt);
+            a *= step;
+            MatrixType qc = g * q * g.Transpose();
+            qc *= step;
+            Discretization<MatrixType> res{MatrixType(n, n), MatrixType(n, n)};
+            memory::ArenaScope scope;
+            lazy::ScratchBuffer<ValueType> scratch(work);
+            lazy::ScratchBuffer<size_t> pivots(2 * n);
+            kernel(n, a.Data(), qc.Data(), res.phi.Data(), res.qd.Data(), scratch.data(), pivots.data());
+            return res;
+        }
+    }
+
+    /// @brief Φ = exp(F dt) and Qd from one 2n x 2n exponential (Van Loan, 1978), fused with the Padé kernel above
+    /// @param g n x p noise input matrix
+    /// @param q p x p continuous noise spectral density
+    template <typename _F, typename _G, typename _Q, typename _Ty>
+    auto Discretize(const _F &f, const _G &g, const _Q &q, _Ty dt)
+    {
+        constexpr size_t order = _F::RowsAtCompileTime;
+        const size_t n = f.Row();
+        return detail::Discretize(f, g, q, dt, 8 * n * n + kernel::ExpPadeWork(2 * n),
+                                  [](size_t size, const auto *a, const auto *qc, auto *phi, auto *qd, auto *work, size_t *pivots)
+                                  { kernel::DiscretizeVanLoan<order>(size, a, qc, phi, qd, work, pivots); });
+    }
+
+    /// @brief Low-order fast mode of Discretize: Φ and Qd as Taylor series in dt up to dt^order, with the
+    /// n x n recursion of kernel::DiscretizeTaylor instead of the 2n x 2n exponential. Order 2 or 3 is the
+    /// usual choice at IMU rates, where ‖F dt‖ is a few thousandths.
+    template <typename _F, typename _G, typename _Q, typename _Ty>
+    auto Discretize(const _F &f, const _G &g, const _Q &q, _Ty dt, size_t order)
+    {
+        constexpr size_t rows = _F::RowsAtCompileTime;
+        const size_t n = f.Row();
+        return detail::Discretize(f, g, q, dt, 2 * n * n,
+                                  [order](size_t size, const auto *a, const auto *qc, auto *phi, auto *qd, auto *work, size_t *)
+                                  { kernel::DiscretizeTaylor<rows>(size, a, qc, order, phi, qd, work); });
+    }
+}
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Matrix.hpp"
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LinerAlgebra
+{
+    namespace io
+    {
+#pragma region "File header"
+        /// @brief Element type tag stored in the file header
+        enum class ElementType : uint32_t
+        {
+            Float32 = 1,
+            Float64 = 2,
+            Int32 = 3,
+            Int64 = 4
+        };
+
+        template <typename _Ty>
+        constexpr ElementType ElementTypeOf()
+        {
+            if constexpr (std::is_same_v<_Ty, float>)
+                return ElementType::Float32;
+            else if constexpr (std::is_same_v<_Ty, double>)
+                return ElementType::Float64;
+            else if constexpr (std::is_same_v<_Ty, int32_t>)
+                return ElementType::Int32;
+            else
+            {
+                static_assert(std::is_same_v<_Ty, int64_t>, "Matrix files hold float, double, int32_t or int64_t");
+                return ElementType::Int64;
+            }
+        }
+
+        constexpr char FileMagic[8] = {'L', 'A', 'M', 'A', 'T', 'R', 'I', 'X'};
+        constexpr uint32_t FileVersion = 1;
+        /// @brief Written in the producer's byte order, a reader on the other endianness sees it reversed
+        constexpr uint32_t ByteOrderMark = 0x01020304;
+
+        /// @brief Fixed 64-byte header. The elements follow at dataOffset, so mapped data is cache-line aligned.
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            ElementType elementType;
+            uint32_t elementSize;
+            StorageOrder order;
+            uint32_t reserved;
+            uint64_t rows;
+            uint64_t cols;
+            uint64_t dataOffset;
+            uint64_t padding;
+        };
+        static_assert(sizeof(FileHeader) == 64 && std::is_trivially_copyable_v<FileHeader>);
+
+        template <typename _Ty>
+        FileHeader MakeHeader(size_t rows, size_t cols, StorageOrder order = StorageOrder::RowMajor)
+        {
+            FileHeader header{};
+            std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+            header.version = FileVersion;
+            header.byteOrder = ByteOrderMark;
+            header.elementType = ElementTypeOf<_Ty>();
+            header.elementSize = sizeof(_Ty);
+            header.order = order;
+            header.rows = rows;
+            header.cols = cols;
+            header.dataOffset = sizeof(FileHeader);
+            return header;
+        }
+
+        /// @brief FileExcept unless header describes _Ty elements this reader can use
+        /// @param fileSize Size of the whole file, 0 when a stream cannot tell
+        template <typename _Ty>
+        void CheckHeader(const FileHeader &header, size_t fileSize)
+        {
+            if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.version != FileVersion ||
+                header.byteOrder != ByteOrderMark || header.elementType != ElementTypeOf<_Ty>() ||
+                header.elementSize != sizeof(_Ty) || header.dataOffset < sizeof(FileHeader) ||
+                (header.order != StorageOrder::RowMajor && header.order != StorageOrder::ColMajor))
+                throw FileExcept();
+            // a mapped file starts page aligned, so an aligned offset gives aligned elements
+            const uint64_t limit = fileSize != 0 ? fileSize : std::numeric_limits<size_t>::max();
+            if (header.dataOffset % alignof(_Ty) != 0 || header.dataOffset > limit)
+                throw FileExcept();
+            // compared by division, rows * cols * sizeof(_Ty) of a forged header can wrap around
+            const uint64_t elements = (limit - header.dataOffset) / sizeof(_Ty);
+            if (header.cols != 0 && header.rows > elements / header.cols)
+                throw FileExcept();
+        }
+#pragma endregion
+
+#pragma region "Memory mapping"
+        /// @brief Read-only mapping of a whole file, unmapped on destruction
+        class MappedFile
+        {
+            const std::byte *data = nullptr;
+            size_t size = 0;
+
+        public:
+            explicit MappedFile(const std::string &path)
+            {
+#if defined(_WIN32)
+                HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file == INVALID_HANDLE_VALUE)
+                    throw FileExcept();
+                LARGE_INTEGER length;
+                HANDLE mapping = GetFileSizeEx(file, &length) && length.QuadPart > 0
+                                     ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+                                     : nullptr;
+                // the view keeps the mapping alive after both handles are closed
+                const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                if (mapping)
+                    CloseHandle(mapping);
+                CloseHandle(file);
+                if (!view)
+                    throw FileExcept();
+                size = static_cast<size_t>(length.QuadPart);
+#else
+                const int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                    throw FileExcept();
+                struct stat status;
+                void *view = MAP_FAILED;
+                if (::fstat(fd, &status) == 0 && status.st_size > 0)
+                    view = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+                if (view == MAP_FAILED)
+                    throw FileExcept();
+                size = static_cast<size_t>(status.st_size);
+#endif
+                data = static_cast<const std::byte *>(view);
+            }
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+            MappedFile(MappedFile &&other) noexcept : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+            MappedFile &operator=(MappedFile &&other) noexcept
+            {
+                std::swap(data, other.data);
+                std::swap(size, other.size);
+                return *this;
+            }
+            ~MappedFile()
+            {
+                if (!data)
+                    return;
+#if defined(_WIN32)
+                UnmapViewOfFile(data);
+#else
+                ::munmap(const_cast<std::byte *>(data), size);
+#endif
+            }
+
+            const std::byte *Data() const noexcept { return data; }
+            size_t Size() const noexcept { return size; }
+        };
+
+        /// @brief Matrix file mapped into memory, View() reads the elements in place without a copy.
+        /// Pages are only read from disk when they are touched.
+        template <typename _Ty = double>
+        class MappedMatrix
+        {
+            MappedFile file;
+            FileHeader header;
+
+        public:
+            explicit MappedMatrix(const std::string &path) : file(path)
+            {
+                if (file.Size() < sizeof(FileHeader))
+                    throw FileExcept();
+                std::memcpy(&header, file.Data(), sizeof(FileHeader));
+                CheckHeader<_Ty>(header, file.Size());
+            }
+
+            size_t Row() const noexcept { return header.rows; }
+            size_t Col() const noexcept { return header.cols; }
+            StorageOrder Order() const noexcept { return header.order; }
+            const _Ty *Data() const noexcept { return reinterpret_cast<const _Ty *>(file.Data() + header.dataOffset); }
+            /// @brief The mapped elements as a read-only view, a column-major file is read through swapped strides.
+            /// The view refers to the mapping and must not outlive this object.
+            lazy::View<const _Ty, Dynamic, Dynamic> View() const
+            {
+                const kernel::StridedRef<const _Ty> ref = header.order == StorageOrder::RowMajor
+                                                              ? kernel::StridedRef<const _Ty>{Data(), Col(), 1}
+                                                              : kernel::StridedRef<const _Ty>{Data(), 1, Row()};
+                return lazy::View<const _Ty, Dynamic, Dynamic>(ref, Row(), Col());
+            }
+        };
+#pragma endregion
+
+#pragma region "Streaming"
+        /// @brief Appends blocks of rows to a row-major matrix file, the row count in the header is patched by Close()
+        template <typename _Ty = double>
+        class BlockWriter
+        {
+            std::FILE *file = nullptr;
+            size_t cols;
+            size_t rows = 0;
+
+            bool WriteHeader()
+            {
+                const FileHeader header = MakeHeader<_Ty>(rows, cols);
+                return std::fwrite(&header, sizeof(FileHeader), 1, file) == 1;
+            }
+
+        public:
+            BlockWriter(const std::string &path, size_t cols) : file(std::fopen(path.c_str(), "wb")), cols(cols)
+            {
+                if (!file)
+                    throw FileExcept();
+                if (!WriteHeader())
+                {
+                    std::fclose(file);
+                    throw FileExcept();
+                }
+            }
+            BlockWriter(const BlockWriter &) = delete;
+            BlockWriter &operator=(const BlockWriter &) = delete;
+            ~BlockWriter()
+            {
+                try
+                {
+                    Close();
+                }
+                catch (const FileExcept &)
+                {
+                }
+            }
+
+            size_t Row() const noexcept { return rows; }
+            size_t Col() const noexcept { return cols; }
+
+            /// @brief Append the rows of a matrix, view or expression with Col() columns
+            template <typename _Mat>
+            BlockWriter &Write(const _Mat &block)
+            {
+                if (!file)
+                    throw FileExcept();
+                if (block.Col() != cols)
+                    throw SizeExcept();
+                const size_t count = block.Row() * cols;
+                memory::ArenaScope scope;
+                lazy::ScratchBuffer<_Ty> buffer;
+                const _Ty *data;
+                if constexpr (lazy::contiguous<_Mat, _Ty>)
+                    data = block.Data();
+                else
+                {
+                    buffer.resize(count);
+                    if constexpr (lazy::expression<_Mat>)
+                        block.EvaluateTo(buffer.data());
+                    else
+                        lazy::ExprStart<_Mat>(block).EvaluateTo(buffer.data());
+                    data = buffer.data();
+                }
+                if (std::fwrite(data, sizeof(_Ty), count, file) != count)
+                    throw FileExcept();
+                rows += block.Row();
+                return *this;
+            }
+
+            /// @brief Write the final row count and close the file
+            void Close()
+            {
+                if (!file)
+                    return;
+                const bool ok = std::fseek(file, 0, SEEK_SET) == 0 && WriteHeader();
+                if (std::fclose(std::exchange(file, nullptr)) != 0 || !ok)
+                    throw FileExcept();
+            }
+        };
+
+        /// @brief Reads a row-major matrix file front to back in blocks of rows, memory use is bounded by the block
+        template <typename _Ty = double>
+        class BlockReader
+        {
+            std::FILE *file;
+            FileHeader header;
+            size_t next = 0;
+
+        public:
+            explicit BlockReader(const std::string &path) : file(std::fopen(path.c_str(), "rb"))
+            {
+                if (!file)
+                    throw FileExcept();
+                if (std::fread(&header, sizeof(FileHeader), 1, file) != 1 ||
+                    std::fseek(file, static_cast<long>(header.dataOffset), SEEK_SET) != 0)
+                {
+                    std::fclose(file);
+                    throw FileExcept();
+                }
+                try
+                {
+                    CheckHeader<_Ty>(header, 0);
+                    // whole rows are only contiguous in a row-major file, map a column-major one instead
+                    if (header.order != StorageOrder::RowMajor)
+                        throw FileExcept();
+                }
+                catch (...)
+                {
+                    std::fclose(file);
+                    throw;
+                }
+            }
+            BlockReader(const BlockReader &) = delete;
+            BlockReader &operator=(const BlockReader &) = delete;
+            ~BlockReader() { std::fclose(file); }
+
+            size_t Row() const noexcept { return header.rows; }
+            size_t Col() const noexcept { return header.cols; }
+            /// @brief Rows not read yet
+            size_t Remaining() const noexcept { return header.rows - next; }
+
+            /// @brief Read up to maxRows further rows into block, resized to the rows read
+            /// @return Rows read, 0 once the whole file has been read
+            template <typename _Alloc>
+            size_t Read(Matrix<Dynamic, Dynamic, _Ty, _Alloc> &block, size_t maxRows)
+            {
+                const size_t count = std::min(maxRows, Remaining());
+                block.Resize(count, Col());
+                if (count != 0 && std::fread(block.Data(), sizeof(_Ty), count * Col(), file) != count * Col())
+                    throw FileExcept();
+                next += count;
+                return count;
+            }
+        };
+#pragma endregion
+
+        /// @brief Write a matrix, view or expression as a row-major matrix file
+        template <typename _Mat>
+        void Save(const std::string &path, const _Mat &mat)
+        {
+            using ValueType = std::remove_cvref_t<decltype(mat[0])>;
+            BlockWriter<ValueType> writer(path, mat.Col());
+            writer.Write(mat);
+            writer.Close();
+        }
+
+        /// @brief Read a whole matrix file into _Mat through a mapping, column-major files are transposed on the way in.
+        /// SizeExcept when a fixed-size _Mat does not match the stored shape.
+        template <typename _Mat = DMatrix<>>
+        _Mat Load(const std::string &path)
+        {
+            const MappedMatrix<typename _Mat::ValueType> mapped(path);
+            return mapped.View();
+        }
+    }
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "Error.hpp"
+#include "Matrix.hpp"
+
+namespace LinerAlgebra
+{
+    namespace io
+    {
+#pragma region "Text formatting"
+        enum class TextLayout
+        {
+            Whitespace, // one row per line, elements separated by a space
+            Csv,        // one row per line, elements separated by a comma
+            Aligned     // right-aligned columns as wide as the widest element
+        };
+
+        /// @brief Layout and number format of a matrix written as text.
+        /// As a format spec: [C|A]std-spec, a leading C or A picks the layout and the rest is the standard spec
+        /// of one element, e.g. "{:12.4f}", "{:C.6e}" or "{:A*^12.3g}".
+        /// Without a type the shortest text that reads back to the same value is written.
+        struct TextSpec
+        {
+            TextLayout layout = TextLayout::Whitespace;
+            size_t width = 0;
+            int precision = -1;
+            char type = 0;
+
+            /// @brief Read the optional layout letter at first, returns the start of the element spec
+            template <typename _It>
+            constexpr _It ParseLayout(_It first, _It last)
+            {
+                if (first != last && (*first == 'C' || *first == 'A'))
+                    layout = *first++ == 'C' ? TextLayout::Csv : TextLayout::Aligned;
+                return first;
+            }
+            /// @brief Read an element spec of the form [width][.precision][f|e|g] that to_chars can write itself
+            /// @return false when [first, last) holds anything else, e.g. fill, sign or another type
+            template <typename _It>
+            constexpr bool ParseNumber(_It first, _It last)
+            {
+                const auto digits = [&](auto &value)
+                {
+                    value = 0;
+                    for (; first != last && *first >= '0' && *first <= '9'; ++first)
+                        value = value * 10 + (*first - '0');
+                };
+                // a leading zero is the zero-padding flag of the standard spec
+                if (first != last && *first == '0')
+                    return false;
+                digits(width);
+                if (first != last && *first == '.')
+                {
+                    ++first;
+                    digits(precision);
+                }
+                if (first != last && (*first == 'f' || *first == 'e' || *first == 'g'))
+                {
+                    type = *first++;
+                    // as in std::format, a type without a precision means 6 digits
+                    if (precision < 0)
+                        precision = 6;
+                }
+                return first == last;
+            }
+        };
+
+        namespace detail
+        {
+            /// @brief to_chars of one element, errc::value_too_large when it does not fit
+            template <typename _Ty>
+            std::to_chars_result ToChars(char *first, char *last, _Ty value, const TextSpec &spec)
+            {
+                if constexpr (std::is_floating_point_v<_Ty>)
+                {
+                    const std::chars_format format = spec.type == 'f'   ? std::chars_format::fixed
+                                                     : spec.type == 'e' ? std::chars_format::scientific
+                                                                        : std::chars_format::general;
+                    if (spec.precision >= 0)
+                        return std::to_chars(first, last, value, format, spec.precision);
+                    if (spec.type != 0)
+                        return std::to_chars(first, last, value, format);
+                }
+                return std::to_chars(first, last, value);
+            }
+
+            /// @brief Append value right-aligned to width
+            template <typename _Ty>
+            void AppendNumber(std::string &out, _Ty value, const TextSpec &spec, size_t width)
+            {
+                // large enough for any shortest or precision-limited double, fixed notation of huge values takes the slow path
+                char text[128];
+                auto [end, ec] = ToChars(text, text + sizeof(text), value, spec);
+                if (ec == std::errc())
+                {
+                    const size_t length = static_cast<size_t>(end - text);
+                    if (length < width)
+                        out.append(width - length, ' ');
+                    out.append(text, length);
+                    return;
+                }
+                std::string wide(size_t(400) + static_cast<size_t>(std::max(spec.precision, 0)), '\0');
+                end = ToChars(wide.data(), wide.data() + wide.size(), value, spec).ptr;
+                wide.resize(static_cast<size_t>(end - wide.data()));
+                if (wide.size() < width)
+                    out.append(width - wide.size(), ' ');
+                out += wide;
+            }
+
+            /// @brief Append the rows of mat to out, append(out, value, width) writes one element right-aligned to width
+            template <typename _Mat, typename _Append>
+            void LayOut(std::string &out, const _Mat &mat, TextLayout layout, size_t width, const _Append &append)
+            {
+                const size_t rows = mat.Row(), cols = mat.Col();
+                if (layout == TextLayout::Aligned)
+                {
+                    std::string text;
+                    for (size_t i = 0; i < rows; ++i)
+                        for (size_t j = 0; j < cols; ++j)
+                        {
+                            text.clear();
+                            append(text, mat(i, j), 0);
+                            width = std::max(width, text.size());
+                        }
+                }
+                const char separator = layout == TextLayout::Csv ? ',' : ' ';
+                // a rough per-element guess, the string grows by doubling if it is short
+                out.reserve(out.size() + rows * cols * (std::max<size_t>(width, 12) + 1));
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    for (size_t j = 0; j < cols; ++j)
+                    {
+                        if (j != 0)
+                            out.push_back(separator);
+                        append(out, mat(i, j), width);
+                    }
+                    out.push_back('\n');
+                }
+            }
+        }
+
+        /// @brief Append mat to out one row at a time, every element goes through to_chars straight into out.
+        /// Reusing out between calls keeps its capacity, so steady logging does not allocate.
+        template <typename _Mat>
+        void FormatTo(std::string &out, const _Mat &mat, const TextSpec &spec = {})
+        {
+            detail::LayOut(out, mat, spec.layout, spec.width, [&](std::string &text, auto value, size_t width)
+                           { detail::AppendNumber(text, value, spec, width); });
+        }
+
+        template <typename _Mat>
+        std::string Format(const _Mat &mat, const TextSpec &spec = {})
+        {
+            std::string out;
+            FormatTo(out, mat, spec);
+            return out;
+        }
+#pragma endregion
+
+#pragma region "Text parsing"
+        /// @brief Read one matrix from the front of text and advance text past it. Rows are lines, elements are
+        /// separated by one comma or by spaces and tabs, an empty field is a ParseExcept, and a blank line or the end of text ends the matrix,
+        /// so a log of matrices written by FormatTo with blank lines in between can be read back in a loop.
+        /// @return false when only blank lines are left
+        template <typename _Mat>
+        bool ParseNext(std::string_view &text, _Mat &out)
+        {
+            using ValueType = typename _Mat::ValueType;
+            thread_local std::vector<ValueType> values;
+            values.clear();
+            const char *cursor = text.data(), *const end = cursor + text.size();
+            const auto skipBlanks = [&]
+            {
+                const char *const start = cursor;
+                while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+                    ++cursor;
+                return cursor != start;
+            };
+            const auto atLineEnd = [&] { return cursor == end || *cursor == '\n'; };
+            size_t rows = 0, cols = 0;
+            while (cursor != end)
+            {
+                size_t count = 0;
+                skipBlanks();
+                while (!atLineEnd())
+                {
+                    // from_chars rejects an explicit plus sign, only one directly in front of a number is skipped
+                    if (*cursor == '+' && end - cursor > 1 && ((cursor[1] >= '0' && cursor[1] <= '9') || cursor[1] == '.'))
+                        ++cursor;
+                    ValueType value;
+                    const auto [next, ec] = std::from_chars(cursor, end, value);
+                    if (ec != std::errc())
+                        throw ParseExcept();
+                    values.push_back(value);
+                    cursor = next;
+                    ++count;
+                    // elements are separated by exactly one comma or by blanks, so an empty field is an error
+                    const bool blank = skipBlanks();
+                    if (atLineEnd())
+                        break;
+                    if (*cursor == ',')
+                    {
+                        ++cursor;
+                        skipBlanks();
+                        if (atLineEnd())
+                            throw ParseExcept();
+                    }
+                    else if (!blank)
+                        throw ParseExcept();
+                }
+                if (cursor != end)
+                    ++cursor;
+                if (count == 0)
+                {
+                    if (rows == 0)
+                        continue;
+                    break;
+                }
+                if (rows == 0)
+                    cols = count;
+                else if (count != cols)
+                    throw ParseExcept();
+                ++rows;
+            }
+            text.remove_prefix(static_cast<size_t>(cursor - text.data()));
+            if (rows == 0)
+                return false;
+            if constexpr (_Mat::IsDynamic())
+                out.Resize(rows, cols);
+            else if (rows != out.Row() || cols != out.Col())
+                throw SizeExcept();
+            std::copy(values.begin(), values.end(), out.Data());
+            return true;
+        }
+
+        /// @brief The matrix at the front of text, ParseExcept when there is none
+        template <typename _Mat = DMatrix<>>
+        _Mat Parse(std::string_view text)
+        {
+            _Mat res;
+            if (!ParseNext(text, res))
+                throw ParseExcept();
+            return res;
+        }
+#pragma endregion
+    }
+}
+
+namespace std
+{
+    /// @brief "{:12.4f}" pads every element to 12 characters with 4 decimals, see io::TextSpec for the layout letters.
+    /// Any standard spec of _Ty is accepted, the common width, precision and f|e|g specs take the to_chars path.
+    template <size_t _Row, size_t _Col, typename _Ty, typename _Alloc>
+    struct formatter<LinerAlgebra::Matrix<_Row, _Col, _Ty, _Alloc>>
+    {
+        LinerAlgebra::io::TextSpec spec;
+        string_view elementSpec;
+        bool toChars = false;
+
+        constexpr auto parse(format_parse_context &ctx)
+        {
+            const auto first = spec.ParseLayout(ctx.begin(), ctx.end());
+            ctx.advance_to(first);
+            // the element formatter checks the rest and throws format_error for a spec _Ty does not take
+            formatter<_Ty> element;
+            const auto last = element.parse(ctx);
+            elementSpec = string_view(first, last);
+            // every element is formatted again later on, an argument for width or precision is not kept
+            if (elementSpec.find('{') != string_view::npos)
+                throw format_error("Nested width or precision is not supported for a matrix");
+            toChars = spec.ParseNumber(first, last);
+            return last;
+        }
+
+        auto format(const LinerAlgebra::Matrix<_Row, _Col, _Ty, _Alloc> &matrix, format_context &ctx) const
+        {
+            // the whole matrix is written as one block instead of one format call per element
+            thread_local std::string text;
+            text.clear();
+            if (toChars)
+                LinerAlgebra::io::FormatTo(text, matrix, spec);
+            else
+            {
+                thread_local std::string pattern;
+                pattern.assign("{:").append(elementSpec).push_back('}');
+                LinerAlgebra::io::detail::LayOut(text, matrix, spec.layout, 0, [&](std::string &out, const _Ty &value, size_t width)
+                                                 {
+                    const size_t start = out.size();
+                    std::vformat_to(std::back_inserter(out), pattern, std::make_format_args(value));
+                    if (out.size() - start < width)
+                        out.insert(start, width - (out.size() - start), ' '); });
+            }
+            return std::copy(text.begin(), text.end(), ctx.out());
+        }
+    };
+}
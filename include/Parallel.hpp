@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LinerAlgebra
+{
+    namespace parallel
+    {
+        constexpr size_t CacheLine = 64;
+
+#pragma region "Configuration"
+        inline std::atomic<size_t> &ThresholdStorage()
+        {
+            static std::atomic<size_t> threshold{size_t(1) << 16};
+            return threshold;
+        }
+        inline std::atomic<size_t> &MaxThreadsStorage()
+        {
+            static std::atomic<size_t> maxThreads{std::max(1u, std::thread::hardware_concurrency())};
+            return maxThreads;
+        }
+
+        /// @brief Work from which heap expressions are evaluated on the thread pool: the element count,
+        /// scaled by the per-element cost of expressions that compute more than one operation per element
+        inline size_t Threshold() { return ThresholdStorage().load(std::memory_order_relaxed); }
+        /// @brief Set the parallel threshold, SIZE_MAX turns the parallel path off
+        inline void SetThreshold(size_t elements) { ThresholdStorage().store(elements, std::memory_order_relaxed); }
+        /// @brief Upper bound of threads (caller included) working on one evaluation
+        inline size_t MaxThreads() { return MaxThreadsStorage().load(std::memory_order_relaxed); }
+        inline void SetMaxThreads(size_t threads) { MaxThreadsStorage().store(std::max<size_t>(1, threads), std::memory_order_relaxed); }
+#pragma endregion
+
+        /// @brief Fixed set of workers that is reused by every parallel evaluation
+        class ThreadPool
+        {
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            std::mutex runMutex;
+            const std::function<void(size_t)> *task = nullptr;
+            size_t taskCount = 0;
+            std::atomic<size_t> next{0};
+            size_t pending = 0;
+            size_t generation = 0;
+            bool stop = false;
+
+            static bool &InParallel()
+            {
+                thread_local bool inParallel = false;
+                return inParallel;
+            }
+
+            void Drain()
+            {
+                for (size_t index = next.fetch_add(1); index < taskCount; index = next.fetch_add(1))
+                    (*task)(index);
+            }
+
+            void WorkerLoop()
+            {
+                InParallel() = true;
+                size_t seen = 0;
+                while (true)
+                {
+                    {
+                        std::unique_lock lock(mutex);
+                        wake.wait(lock, [&] { return stop || generation != seen; });
+                        if (stop)
+                            return;
+                        seen = generation;
+                    }
+                    Drain();
+                    std::lock_guard lock(mutex);
+                    if (--pending == 0)
+                        done.notify_one();
+                }
+            }
+
+        public:
+            explicit ThreadPool(size_t threads)
+            {
+                workers.reserve(threads);
+                for (size_t i = 0; i < threads; ++i)
+                    workers.emplace_back([this] { WorkerLoop(); });
+            }
+            ThreadPool(const ThreadPool &) = delete;
+            ThreadPool &operator=(const ThreadPool &) = delete;
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard lock(mutex);
+                    stop = true;
+                }
+                wake.notify_all();
+                for (auto &worker : workers)
+                    worker.join();
+            }
+
+            /// @brief Shared pool with one worker per hardware thread besides the caller
+            static ThreadPool &Instance()
+            {
+                static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+                return pool;
+            }
+
+            size_t ThreadCount() const noexcept { return workers.size() + 1; }
+
+            /// @brief Run func(0) ... func(count - 1) on the workers and the calling thread, then wait
+            /// Nested calls and calls while another thread owns the pool run inline instead of deadlocking.
+            void Run(size_t count, const std::function<void(size_t)> &func)
+            {
+                std::unique_lock runLock(runMutex, std::defer_lock);
+                if (workers.empty() || InParallel() || !runLock.try_lock())
+                {
+                    for (size_t index = 0; index < count; ++index)
+                        func(index);
+                    return;
+                }
+                {
+                    std::lock_guard lock(mutex);
+                    task = &func;
+                    taskCount = count;
+                    next.store(0);
+                    pending = workers.size();
+                    ++generation;
+                }
+                wake.notify_all();
+                InParallel() = true;
+                Drain();
+                InParallel() = false;
+                std::unique_lock lock(mutex);
+                done.wait(lock, [&] { return pending == 0; });
+                task = nullptr;
+            }
+        };
+
+        /// @brief Split [0, size) of a destination buffer into cache-line aligned chunks and run them on the pool
+        /// @param dst Destination the chunks are aligned against, so no two threads write the same cache line
+        /// @param func Callable taking (begin, end)
+        template <typename _Ty, typename _Func>
+        void ParallelFor(const _Ty *dst, size_t size, _Func &&func)
+        {
+            constexpr size_t lineElements = std::max<size_t>(1, CacheLine / sizeof(_Ty));
+            ThreadPool &pool = ThreadPool::Instance();
+            const size_t threads = std::min(pool.ThreadCount(), MaxThreads());
+            // first index whose address starts a cache line
+            const size_t misalign = reinterpret_cast<std::uintptr_t>(dst) % CacheLine;
+            const size_t head = std::min(size, misalign == 0 ? 0 : (CacheLine - misalign) / sizeof(_Ty));
+            // a few chunks per thread keeps the load balanced when cores run at different speeds,
+            // but with a capped thread count one chunk each keeps idle workers from joining in
+            const size_t chunks = threads * (threads < pool.ThreadCount() ? 1 : 4);
+            size_t chunk = (size - head + chunks - 1) / chunks;
+            chunk = std::max(lineElements, (chunk + lineElements - 1) / lineElements * lineElements);
+            const size_t count = (size - head + chunk - 1) / chunk;
+            if (threads <= 1 || count <= 1)
+            {
+                func(size_t(0), size);
+                return;
+            }
+            const auto task = [&](size_t index)
+            {
+                const size_t begin = index == 0 ? 0 : head + index * chunk;
+                const size_t end = std::min(size, head + (index + 1) * chunk);
+                func(begin, end);
+            };
+            // a reference fits in the std::function itself, the lambda would be copied to the heap
+            pool.Run(count, std::cref(task));
+        }
+
+        /// @brief Split [0, size) into contiguous ranges of at least grain items and run them on the pool,
+        /// for work that is partitioned by rows rather than by destination elements
+        /// @param func Callable taking (begin, end)
+        template <typename _Func>
+        void ParallelRanges(size_t size, size_t grain, _Func &&func)
+        {
+            ThreadPool &pool = ThreadPool::Instance();
+            const size_t threads = std::min(pool.ThreadCount(), MaxThreads());
+            const size_t chunks = threads * (threads < pool.ThreadCount() ? 1 : 4);
+            const size_t chunk = std::max(std::max<size_t>(grain, 1), (size + chunks - 1) / chunks);
+            const size_t count = (size + chunk - 1) / chunk;
+            if (threads <= 1 || count <= 1)
+            {
+                func(size_t(0), size);
+                return;
+            }
+            const auto task = [&](size_t index)
+            {
+                func(index * chunk, std::min(size, (index + 1) * chunk));
+            };
+            pool.Run(count, std::cref(task));
+        }
+    }
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include "Matrix.hpp"
+#include "MatrixBatch.hpp"
+
+namespace LinerAlgebra
+{
+    template <typename _Ty>
+    class Quaternion;
+    template <typename _Ty>
+    class RotationMatrix;
+    template <typename _Ty>
+    class RotationVector;
+
+    namespace kernel
+    {
+#pragma region "Rotation kernels"
+        // The kernels below are straight-line code apart from one choice: rotations under SeriesAngle2 use a Taylor
+        // series instead of sin, cos and a division by the angle. Gyro increments of one sample are far below it,
+        // so in a strapdown loop the choice is always the same, perfectly predicted, and no transcendental is called.
+
+        /// @brief Squared angle below which the series of degree 8 in θ are exact to the last bit of a double
+        template <typename _Ty>
+        constexpr _Ty SeriesAngle2 = _Ty(1e-2);
+
+        /// @brief q = exp(v / 2) as w, x, y, z
+        template <typename _Ty>
+        inline void RotationVectorToQuaternion(const _Ty *v, _Ty *q)
+        {
+            const _Ty t = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+            _Ty w, scale;
+            if (t < SeriesAngle2<_Ty>)
+            {
+                // cos(θ / 2) and sin(θ / 2) / θ
+                w = _Ty(1) - t / _Ty(8) * (_Ty(1) - t / _Ty(48) * (_Ty(1) - t / _Ty(120) * (_Ty(1) - t / _Ty(224))));
+                scale = _Ty(0.5) * (_Ty(1) - t / _Ty(24) * (_Ty(1) - t / _Ty(80) * (_Ty(1) - t / _Ty(168) * (_Ty(1) - t / _Ty(288)))));
+            }
+            else
+            {
+                const _Ty angle = std::sqrt(t);
+                w = std::cos(_Ty(0.5) * angle);
+                scale = std::sin(_Ty(0.5) * angle) / angle;
+            }
+            q[0] = w;
+            q[1] = v[0] * scale;
+            q[2] = v[1] * scale;
+            q[3] = v[2] * scale;
+        }
+
+        /// @brief v = 2 log(q) for a unit q, taking the shorter of the two rotations q and -q describe
+        template <typename _Ty>
+        inline void QuaternionToRotationVector(const _Ty *q, _Ty *v)
+        {
+            const _Ty norm2 = q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+            const _Ty norm = std::sqrt(norm2);
+            const _Ty w = std::abs(q[0]);
+            // 2 atan(n / w) / n ≈ 2 / w * (1 - n² / (3 w²)) near the identity, where n / w is below 1e-8
+            const _Ty scale = std::copysign(norm2 < _Ty(1e-16) ? _Ty(2) / w * (_Ty(1) - norm2 / (_Ty(3) * w * w))
+                                                               : _Ty(2) * std::atan2(norm, w) / norm,
+                                            q[0]);
+            v[0] = q[1] * scale;
+            v[1] = q[2] * scale;
+            v[2] = q[3] * scale;
+        }
+
+        /// @brief Row-major 3 x 3 r of a unit quaternion q
+        template <typename _Ty>
+        constexpr void QuaternionToMatrix(const _Ty *q, _Ty *r)
+        {
+            const _Ty w = q[0], x = q[1], y = q[2], z = q[3];
+            const _Ty xx = x * x, yy = y * y, zz = z * z;
+            const _Ty xy = x * y, xz = x * z, yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+            r[0] = _Ty(1) - _Ty(2) * (yy + zz);
+            r[1] = _Ty(2) * (xy - wz);
+            r[2] = _Ty(2) * (xz + wy);
+            r[3] = _Ty(2) * (xy + wz);
+            r[4] = _Ty(1) - _Ty(2) * (xx + zz);
+            r[5] = _Ty(2) * (yz - wx);
+            r[6] = _Ty(2) * (xz - wy);
+            r[7] = _Ty(2) * (yz + wx);
+            r[8] = _Ty(1) - _Ty(2) * (xx + yy);
+        }
+
+        /// @brief Unit quaternion of a rotation matrix by Shepperd's method: 4 q q[k] is row k of the symmetric
+        /// matrix below, read at the largest diagonal so nothing is divided by a small number.
+        /// The row is picked by index instead of the usual four-way branch.
+        template <typename _Ty>
+        inline void MatrixToQuaternion(const _Ty *r, _Ty *q)
+        {
+            const _Ty p[4][4] = {{_Ty(1) + r[0] + r[4] + r[8], r[7] - r[5], r[2] - r[6], r[3] - r[1]},
+                                 {r[7] - r[5], _Ty(1) + r[0] - r[4] - r[8], r[1] + r[3], r[2] + r[6]},
+                                 {r[2] - r[6], r[1] + r[3], _Ty(1) - r[0] + r[4] - r[8], r[5] + r[7]},
+                                 {r[3] - r[1], r[2] + r[6], r[5] + r[7], _Ty(1) - r[0] - r[4] + r[8]}};
+            size_t k = 0;
+            for (size_t i = 1; i < 4; ++i)
+                k = p[i][i] > p[k][k] ? i : k;
+            const _Ty scale = _Ty(0.5) / std::sqrt(p[k][k]);
+            for (size_t i = 0; i < 4; ++i)
+                q[i] = p[k][i] * scale;
+        }
+
+        /// @brief Rodrigues' formula r = I + sin θ / θ [v]ₓ + (1 - cos θ) / θ² [v]ₓ²
+        template <typename _Ty>
+        inline void RotationVectorToMatrix(const _Ty *v, _Ty *r)
+        {
+            const _Ty t = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+            _Ty a, b;
+            if (t < SeriesAngle2<_Ty>)
+            {
+                a = _Ty(1) - t / _Ty(6) * (_Ty(1) - t / _Ty(20) * (_Ty(1) - t / _Ty(42) * (_Ty(1) - t / _Ty(72))));
+                b = _Ty(0.5) * (_Ty(1) - t / _Ty(12) * (_Ty(1) - t / _Ty(30) * (_Ty(1) - t / _Ty(56) * (_Ty(1) - t / _Ty(90)))));
+            }
+            else
+            {
+                const _Ty angle = std::sqrt(t);
+                a = std::sin(angle) / angle;
+                b = (_Ty(1) - std::cos(angle)) / t;
+            }
+            const _Ty x = v[0], y = v[1], z = v[2];
+            r[0] = _Ty(1) - b * (y * y + z * z);
+            r[1] = b * x * y - a * z;
+            r[2] = b * x * z + a * y;
+            r[3] = b * x * y + a * z;
+            r[4] = _Ty(1) - b * (x * x + z * z);
+            r[5] = b * y * z - a * x;
+            r[6] = b * x * z - a * y;
+            r[7] = b * y * z + a * x;
+            r[8] = _Ty(1) - b * (x * x + y * y);
+        }
+
+        /// @brief c = a * b for row-major 3 x 3 matrices, written out so it inlines into a per-sample loop
+        /// where the generic FixedProduct is left as a call. c may alias a or b.
+        template <typename _Ty>
+        constexpr void Compose(const _Ty *a, const _Ty *b, _Ty *c)
+        {
+            const _Ty a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3], a4 = a[4], a5 = a[5], a6 = a[6], a7 = a[7], a8 = a[8];
+            const _Ty b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3], b4 = b[4], b5 = b[5], b6 = b[6], b7 = b[7], b8 = b[8];
+            c[0] = a0 * b0 + a1 * b3 + a2 * b6;
+            c[1] = a0 * b1 + a1 * b4 + a2 * b7;
+            c[2] = a0 * b2 + a1 * b5 + a2 * b8;
+            c[3] = a3 * b0 + a4 * b3 + a5 * b6;
+            c[4] = a3 * b1 + a4 * b4 + a5 * b7;
+            c[5] = a3 * b2 + a4 * b5 + a5 * b8;
+            c[6] = a6 * b0 + a7 * b3 + a8 * b6;
+            c[7] = a6 * b1 + a7 * b4 + a8 * b7;
+            c[8] = a6 * b2 + a7 * b5 + a8 * b8;
+        }
+
+        /// @brief out = r * in for count xyz triples, in and out may be the same array
+        template <typename _Ty>
+        constexpr void RotateVectors(const _Ty *r, const _Ty *in, _Ty *out, size_t count)
+        {
+            const _Ty r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4], r5 = r[5], r6 = r[6], r7 = r[7], r8 = r[8];
+            for (size_t k = 0; k < count; ++k, in += 3, out += 3)
+            {
+                const _Ty x = in[0], y = in[1], z = in[2];
+                out[0] = r0 * x + r1 * y + r2 * z;
+                out[1] = r3 * x + r4 * y + r5 * z;
+                out[2] = r6 * x + r7 * y + r8 * z;
+            }
+        }
+
+        /// @brief out = r * in for the _N vectors of a 3 x 1 batch, a packet of vectors per step, in and out may be the same batch.
+        /// r is copied first: a store through out could alias it, which would reload all nine coefficients every step.
+        template <size_t _N, typename _Ty>
+        inline void BatchRotate(const _Ty *r, const _Ty *in, _Ty *out)
+        {
+            const _Ty r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4], r5 = r[5], r6 = r[6], r7 = r[7], r8 = r[8];
+            ForEachLane<_N, _Ty>([&](size_t lane, auto ops)
+                                 {
+                const auto x = ops.Load(in + lane), y = ops.Load(in + _N + lane), z = ops.Load(in + 2 * _N + lane);
+                ops.Store(out + lane, ops.Add(ops.Add(ops.Mul(ops.Set1(r0), x), ops.Mul(ops.Set1(r1), y)), ops.Mul(ops.Set1(r2), z)));
+                ops.Store(out + _N + lane, ops.Add(ops.Add(ops.Mul(ops.Set1(r3), x), ops.Mul(ops.Set1(r4), y)), ops.Mul(ops.Set1(r5), z)));
+                ops.Store(out + 2 * _N + lane, ops.Add(ops.Add(ops.Mul(ops.Set1(r6), x), ops.Mul(ops.Set1(r7), y)), ops.Mul(ops.Set1(r8), z))); });
+        }
+#pragma endregion
+    }
+
+#pragma region "Quaternion"
+    /// @brief Hamilton unit quaternion w + xi + yj + zk, q * v * q⁻¹ rotates v.
+    /// q1 * q2 applies q2 first, the same order as the matching rotation matrices.
+    template <typename _Ty = double>
+    class Quaternion
+    {
+        std::array<_Ty, 4> coeffs{_Ty(1), _Ty(0), _Ty(0), _Ty(0)};
+
+    public:
+        using ValueType = _Ty;
+        using VectorType = Matrix<3, 1, _Ty>;
+
+        /// @brief Identity rotation
+        constexpr Quaternion() = default;
+        constexpr Quaternion(_Ty w, _Ty x, _Ty y, _Ty z) : coeffs{w, x, y, z} {}
+        explicit Quaternion(const RotationMatrix<_Ty> &r) { kernel::MatrixToQuaternion(r.Data(), coeffs.data()); }
+        explicit Quaternion(const RotationVector<_Ty> &v) { kernel::RotationVectorToQuaternion(v.Data(), coeffs.data()); }
+
+        static constexpr Quaternion Identity() { return {}; }
+
+        constexpr _Ty W() const noexcept { return coeffs[0]; }
+        constexpr _Ty X() const noexcept { return coeffs[1]; }
+        constexpr _Ty Y() const noexcept { return coeffs[2]; }
+        constexpr _Ty Z() const noexcept { return coeffs[3]; }
+        /// @brief w, x, y, z
+        constexpr const _Ty *Data() const noexcept { return coeffs.data(); }
+        constexpr _Ty *Data() noexcept { return coeffs.data(); }
+        /// @brief Vector part x, y, z
+        constexpr VectorType Vec() const
+        {
+            VectorType res;
+            std::copy_n(coeffs.data() + 1, 3, res.Data());
+            return res;
+        }
+
+        /// @brief Composition, this after other
+        constexpr Quaternion operator*(const Quaternion &other) const
+        {
+            const _Ty w1 = W(), x1 = X(), y1 = Y(), z1 = Z();
+            const _Ty w2 = other.W(), x2 = other.X(), y2 = other.Y(), z2 = other.Z();
+            return {w1 * w2 - x1 * x2 - y1 * y2 - z1 * z2,
+                    w1 * x2 + x1 * w2 + y1 * z2 - z1 * y2,
+                    w1 * y2 - x1 * z2 + y1 * w2 + z1 * x2,
+                    w1 * z2 + x1 * y2 - y1 * x2 + z1 * w2};
+        }
+        constexpr Quaternion &operator*=(const Quaternion &other) { return *this = *this * other; }
+
+        /// @brief v + 2w (u × v) + 2u × (u × v) with u the vector part, 15 multiplications against 27 through a matrix
+        constexpr VectorType operator*(const VectorType &v) const
+        {
+            VectorType res;
+            Rotate(v.Data(), res.Data());
+            return res;
+        }
+        constexpr void Rotate(const _Ty *v, _Ty *out) const
+        {
+            const _Ty w = W(), x = X(), y = Y(), z = Z();
+            const _Ty tx = _Ty(2) * (y * v[2] - z * v[1]);
+            const _Ty ty = _Ty(2) * (z * v[0] - x * v[2]);
+            const _Ty tz = _Ty(2) * (x * v[1] - y * v[0]);
+            const _Ty ox = v[0] + w * tx + (y * tz - z * ty);
+            const _Ty oy = v[1] + w * ty + (z * tx - x * tz);
+            const _Ty oz = v[2] + w * tz + (x * ty - y * tx);
+            out[0] = ox;
+            out[1] = oy;
+            out[2] = oz;
+        }
+        /// @brief Rotate count xyz triples, one rotation matrix is formed and reused when that is cheaper
+        void Rotate(const _Ty *in, _Ty *out, size_t count) const
+        {
+            if (count < 2)
+            {
+                if (count == 1)
+                    Rotate(in, out);
+                return;
+            }
+            std::array<_Ty, 9> r;
+            kernel::QuaternionToMatrix(Data(), r.data());
+            kernel::RotateVectors(r.data(), in, out, count);
+        }
+
+        /// @brief The inverse rotation of a unit quaternion
+        constexpr Quaternion Conjugate() const { return {W(), -X(), -Y(), -Z()}; }
+        constexpr Quaternion Inverse() const { return Conjugate(); }
+
+        constexpr _Ty SquaredNorm() const { return W() * W() + X() * X() + Y() * Y() + Z() * Z(); }
+        _Ty Norm() const { return std::sqrt(SquaredNorm()); }
+        constexpr _Ty Dot(const Quaternion &other) const { return W() * other.W() + X() * other.X() + Y() * other.Y() + Z() * other.Z(); }
+        /// @brief Back onto the unit sphere after rounding has drifted it, the caller decides how often
+        Quaternion &Normalize()
+        {
+            const _Ty inv = _Ty(1) / Norm();
+            for (_Ty &c : coeffs)
+                c *= inv;
+            return *this;
+        }
+        Quaternion Normalized() const { return Quaternion(*this).Normalize(); }
+
+        /// @brief exp(v / 2), the rotation by |v| about v
+        static Quaternion Exp(const RotationVector<_Ty> &v) { return Quaternion(v); }
+        /// @brief 2 log(q), the rotation vector of angle at most π
+        RotationVector<_Ty> Log() const
+        {
+            RotationVector<_Ty> v;
+            kernel::QuaternionToRotationVector(Data(), v.Data());
+            return v;
+        }
+        RotationMatrix<_Ty> ToRotationMatrix() const { return RotationMatrix<_Ty>(*this); }
+        Matrix<3, 3, _Ty> ToMatrix() const { return ToRotationMatrix().ToMatrix(); }
+    };
+#pragma endregion
+
+#pragma region "RotationMatrix"
+    /// @brief Orthonormal 3 x 3 direction cosine matrix with unrolled compose and rotate, Matrix<3, 3> through ToMatrix()
+    template <typename _Ty = double>
+    class RotationMatrix
+    {
+        std::array<_Ty, 9> elements{_Ty(1), _Ty(0), _Ty(0), _Ty(0), _Ty(1), _Ty(0), _Ty(0), _Ty(0), _Ty(1)};
+
+    public:
+        using ValueType = _Ty;
+        using VectorType = Matrix<3, 1, _Ty>;
+
+        /// @brief Identity rotation
+        constexpr RotationMatrix() = default;
+        /// @brief Take a 3 x 3 matrix as is, call Normalize() if it is not orthonormal already
+        template <typename _Mat>
+        explicit RotationMatrix(const _Mat &mat)
+        {
+            const Matrix<3, 3, _Ty> r = mat;
+            std::copy_n(r.Data(), 9, elements.data());
+        }
+        explicit RotationMatrix(const Quaternion<_Ty> &q) { kernel::QuaternionToMatrix(q.Data(), elements.data()); }
+        explicit RotationMatrix(const RotationVector<_Ty> &v) { kernel::RotationVectorToMatrix(v.Data(), elements.data()); }
+
+        static constexpr RotationMatrix Identity() { return {}; }
+
+        constexpr _Ty operator()(size_t row, size_t col) const { return elements[row * 3 + col]; }
+        /// @brief Row-major elements
+        constexpr const _Ty *Data() const noexcept { return elements.data(); }
+        constexpr _Ty *Data() noexcept { return elements.data(); }
+        constexpr Matrix<3, 3, _Ty> ToMatrix() const
+        {
+            Matrix<3, 3, _Ty> res;
+            std::copy_n(elements.data(), 9, res.Data());
+            return res;
+        }
+
+        /// @brief Composition, this after other
+        constexpr RotationMatrix operator*(const RotationMatrix &other) const
+        {
+            RotationMatrix res;
+            kernel::Compose(Data(), other.Data(), res.Data());
+            return res;
+        }
+        constexpr RotationMatrix &operator*=(const RotationMatrix &other)
+        {
+            kernel::Compose(Data(), other.Data(), Data());
+            return *this;
+        }
+        constexpr VectorType operator*(const VectorType &v) const
+        {
+            VectorType res;
+            kernel::RotateVectors(Data(), v.Data(), res.Data(), 1);
+            return res;
+        }
+        /// @brief Rotate count xyz triples, e.g. the samples of one IMU frame
+        void Rotate(const _Ty *in, _Ty *out, size_t count) const { kernel::RotateVectors(Data(), in, out, count); }
+        /// @brief Rotate every vector of a structure-of-arrays batch into out, a packet of vectors per step.
+        /// Faster than the xyz-triple Rotate once out is reused; out may be v.
+        template <size_t _N>
+        void Rotate(const MatrixBatch<3, 1, _N, _Ty> &v, MatrixBatch<3, 1, _N, _Ty> &out) const
+        {
+            kernel::BatchRotate<_N>(Data(), v.Data(), out.Data());
+        }
+        /// @brief Rotate every vector of a structure-of-arrays batch into a new batch
+        template <size_t _N>
+        MatrixBatch<3, 1, _N, _Ty> Rotate(const MatrixBatch<3, 1, _N, _Ty> &v) const
+        {
+            MatrixBatch<3, 1, _N, _Ty> res;
+            Rotate(v, res);
+            return res;
+        }
+
+        /// @brief The inverse rotation, no division involved
+        constexpr RotationMatrix Transpose() const
+        {
+            RotationMatrix res;
+            kernel::FixedTranspose<3, 3>(Data(), res.Data());
+            return res;
+        }
+        constexpr RotationMatrix Inverse() const { return Transpose(); }
+
+        /// @brief One step of R ← R (3I - RᵀR) / 2, which removes the first-order drift of repeated products
+        constexpr RotationMatrix &Normalize()
+        {
+            std::array<_Ty, 9> rtr;
+            kernel::Compose(Transpose().Data(), Data(), rtr.data());
+            for (size_t i = 0; i < 9; ++i)
+                rtr[i] = (i % 4 == 0 ? _Ty(1.5) : _Ty(0)) - _Ty(0.5) * rtr[i];
+            kernel::Compose(Data(), rtr.data(), Data());
+            return *this;
+        }
+        constexpr RotationMatrix Normalized() const { return RotationMatrix(*this).Normalize(); }
+
+        static RotationMatrix Exp(const RotationVector<_Ty> &v) { return RotationMatrix(v); }
+        /// @brief Rotation vector of angle at most π
+        RotationVector<_Ty> Log() const { return Quaternion<_Ty>(*this).Log(); }
+        Quaternion<_Ty> ToQuaternion() const { return Quaternion<_Ty>(*this); }
+    };
+#pragma endregion
+
+#pragma region "RotationVector"
+    /// @brief Rotation by Angle() about Vec() / Angle(), e.g. the integrated angular increment of one gyro sample
+    template <typename _Ty = double>
+    class RotationVector
+    {
+        std::array<_Ty, 3> elements{};
+
+    public:
+        using ValueType = _Ty;
+        using VectorType = Matrix<3, 1, _Ty>;
+
+        /// @brief No rotation
+        constexpr RotationVector() = default;
+        constexpr RotationVector(_Ty x, _Ty y, _Ty z) : elements{x, y, z} {}
+        template <typename _Mat>
+        explicit RotationVector(const _Mat &mat)
+        {
+            const VectorType v = mat;
+            std::copy_n(v.Data(), 3, elements.data());
+        }
+
+        constexpr _Ty operator[](size_t index) const { return elements[index]; }
+        constexpr _Ty &operator[](size_t index) { return elements[index]; }
+        constexpr const _Ty *Data() const noexcept { return elements.data(); }
+        constexpr _Ty *Data() noexcept { return elements.data(); }
+        constexpr VectorType Vec() const
+        {
+            VectorType res;
+            std::copy_n(elements.data(), 3, res.Data());
+            return res;
+        }
+        _Ty Angle() const { return std::sqrt(elements[0] * elements[0] + elements[1] * elements[1] + elements[2] * elements[2]); }
+
+        Quaternion<_Ty> ToQuaternion() const { return Quaternion<_Ty>(*this); }
+        RotationMatrix<_Ty> ToRotationMatrix() const { return RotationMatrix<_Ty>(*this); }
+    };
+#pragma endregion
+}
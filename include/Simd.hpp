@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+
+#if !defined(LINERALGEBRA_NO_SIMD)
+#if defined(__AVX__)
+#define LINERALGEBRA_SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINERALGEBRA_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace LinerAlgebra
+{
+    namespace simd
+    {
+        /// @brief Register-wide group of elements, scalar fallback of width one
+        /// @tparam _Ty Element Type
+        template <typename _Ty>
+        struct Packet
+        {
+            static constexpr size_t Size = 1;
+            _Ty value;
+        };
+
+#pragma region "Scalar fallback"
+        template <typename _Ty>
+        inline Packet<_Ty> Load(const _Ty *ptr) { return {*ptr}; }
+        template <typename _Ty>
+        inline void Store(_Ty *ptr, const Packet<_Ty> &p) { *ptr = p.value; }
+        template <typename _Ty>
+        inline Packet<_Ty> Set1(_Ty value) { return {value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Add(const Packet<_Ty> &a, const Packet<_Ty> &b) { return {a.value + b.value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Sub(const Packet<_Ty> &a, const Packet<_Ty> &b) { return {a.value - b.value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Mul(const Packet<_Ty> &a, const Packet<_Ty> &b) { return {a.value * b.value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Div(const Packet<_Ty> &a, const Packet<_Ty> &b) { return {a.value / b.value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Max(const Packet<_Ty> &a, const Packet<_Ty> &b) { return {a.value < b.value ? b.value : a.value}; }
+        template <typename _Ty>
+        inline Packet<_Ty> Abs(const Packet<_Ty> &a) { return {a.value < _Ty(0) ? -a.value : a.value}; }
+        /// @brief Sum of the lanes
+        template <typename _Ty>
+        inline _Ty ReduceAdd(const Packet<_Ty> &p) { return p.value; }
+        /// @brief Largest lane
+        template <typename _Ty>
+        inline _Ty ReduceMax(const Packet<_Ty> &p) { return p.value; }
+        template <typename _Ty>
+        inline Packet<_Ty> Sqrt(const Packet<_Ty> &a) { return {std::sqrt(a.value)}; }
+#pragma endregion
+
+#if defined(LINERALGEBRA_SIMD_AVX)
+#pragma region "AVX"
+        template <>
+        struct Packet<double>
+        {
+            static constexpr size_t Size = 4;
+            __m256d value;
+        };
+        template <>
+        struct Packet<float>
+        {
+            static constexpr size_t Size = 8;
+            __m256 value;
+        };
+
+        inline Packet<double> Load(const double *ptr) { return {_mm256_loadu_pd(ptr)}; }
+        inline void Store(double *ptr, const Packet<double> &p) { _mm256_storeu_pd(ptr, p.value); }
+        inline Packet<double> Set1(double value) { return {_mm256_set1_pd(value)}; }
+        inline Packet<double> Add(const Packet<double> &a, const Packet<double> &b) { return {_mm256_add_pd(a.value, b.value)}; }
+        inline Packet<double> Sub(const Packet<double> &a, const Packet<double> &b) { return {_mm256_sub_pd(a.value, b.value)}; }
+        inline Packet<double> Mul(const Packet<double> &a, const Packet<double> &b) { return {_mm256_mul_pd(a.value, b.value)}; }
+        inline Packet<double> Div(const Packet<double> &a, const Packet<double> &b) { return {_mm256_div_pd(a.value, b.value)}; }
+        inline Packet<double> Max(const Packet<double> &a, const Packet<double> &b) { return {_mm256_max_pd(a.value, b.value)}; }
+        inline Packet<double> Abs(const Packet<double> &a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.value)}; }
+        inline Packet<double> Sqrt(const Packet<double> &a) { return {_mm256_sqrt_pd(a.value)}; }
+        inline double ReduceAdd(const Packet<double> &p)
+        {
+            const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(p.value), _mm256_extractf128_pd(p.value, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+        inline double ReduceMax(const Packet<double> &p)
+        {
+            const __m128d pair = _mm_max_pd(_mm256_castpd256_pd128(p.value), _mm256_extractf128_pd(p.value, 1));
+            return _mm_cvtsd_f64(_mm_max_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+
+        inline Packet<float> Load(const float *ptr) { return {_mm256_loadu_ps(ptr)}; }
+        inline void Store(float *ptr, const Packet<float> &p) { _mm256_storeu_ps(ptr, p.value); }
+        inline Packet<float> Set1(float value) { return {_mm256_set1_ps(value)}; }
+        inline Packet<float> Add(const Packet<float> &a, const Packet<float> &b) { return {_mm256_add_ps(a.value, b.value)}; }
+        inline Packet<float> Sub(const Packet<float> &a, const Packet<float> &b) { return {_mm256_sub_ps(a.value, b.value)}; }
+        inline Packet<float> Mul(const Packet<float> &a, const Packet<float> &b) { return {_mm256_mul_ps(a.value, b.value)}; }
+        inline Packet<float> Div(const Packet<float> &a, const Packet<float> &b) { return {_mm256_div_ps(a.value, b.value)}; }
+        inline Packet<float> Max(const Packet<float> &a, const Packet<float> &b) { return {_mm256_max_ps(a.value, b.value)}; }
+        inline Packet<float> Abs(const Packet<float> &a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.value)}; }
+        inline Packet<float> Sqrt(const Packet<float> &a) { return {_mm256_sqrt_ps(a.value)}; }
+        inline float ReduceAdd(const Packet<float> &p)
+        {
+            __m128 quad = _mm_add_ps(_mm256_castps256_ps128(p.value), _mm256_extractf128_ps(p.value, 1));
+            quad = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+            return _mm_cvtss_f32(_mm_add_ss(quad, _mm_shuffle_ps(quad, quad, 1)));
+        }
+        inline float ReduceMax(const Packet<float> &p)
+        {
+            __m128 quad = _mm_max_ps(_mm256_castps256_ps128(p.value), _mm256_extractf128_ps(p.value, 1));
+            quad = _mm_max_ps(quad, _mm_movehl_ps(quad, quad));
+            return _mm_cvtss_f32(_mm_max_ss(quad, _mm_shuffle_ps(quad, quad, 1)));
+        }
+#pragma endregion
+#elif defined(LINERALGEBRA_SIMD_SSE2)
+#pragma region "SSE2"
+        template <>
+        struct Packet<double>
+        {
+            static constexpr size_t Size = 2;
+            __m128d value;
+        };
+        template <>
+        struct Packet<float>
+        {
+            static constexpr size_t Size = 4;
+            __m128 value;
+        };
+
+        inline Packet<double> Load(const double *ptr) { return {_mm_loadu_pd(ptr)}; }
+        inline void Store(double *ptr, const Packet<double> &p) { _mm_storeu_pd(ptr, p.value); }
+        inline Packet<double> Set1(double value) { return {_mm_set1_pd(value)}; }
+        inline Packet<double> Add(const Packet<double> &a, const Packet<double> &b) { return {_mm_add_pd(a.value, b.value)}; }
+        inline Packet<double> Sub(const Packet<double> &a, const Packet<double> &b) { return {_mm_sub_pd(a.value, b.value)}; }
+        inline Packet<double> Mul(const Packet<double> &a, const Packet<double> &b) { return {_mm_mul_pd(a.value, b.value)}; }
+        inline Packet<double> Div(const Packet<double> &a, const Packet<double> &b) { return {_mm_div_pd(a.value, b.value)}; }
+        inline Packet<double> Max(const Packet<double> &a, const Packet<double> &b) { return {_mm_max_pd(a.value, b.value)}; }
+        inline Packet<double> Abs(const Packet<double> &a) { return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.value)}; }
+        inline Packet<double> Sqrt(const Packet<double> &a) { return {_mm_sqrt_pd(a.value)}; }
+        inline double ReduceAdd(const Packet<double> &p) { return _mm_cvtsd_f64(_mm_add_sd(p.value, _mm_unpackhi_pd(p.value, p.value))); }
+        inline double ReduceMax(const Packet<double> &p) { return _mm_cvtsd_f64(_mm_max_sd(p.value, _mm_unpackhi_pd(p.value, p.value))); }
+
+        inline Packet<float> Load(const float *ptr) { return {_mm_loadu_ps(ptr)}; }
+        inline void Store(float *ptr, const Packet<float> &p) { _mm_storeu_ps(ptr, p.value); }
+        inline Packet<float> Set1(float value) { return {_mm_set1_ps(value)}; }
+        inline Packet<float> Add(const Packet<float> &a, const Packet<float> &b) { return {_mm_add_ps(a.value, b.value)}; }
+        inline Packet<float> Sub(const Packet<float> &a, const Packet<float> &b) { return {_mm_sub_ps(a.value, b.value)}; }
+        inline Packet<float> Mul(const Packet<float> &a, const Packet<float> &b) { return {_mm_mul_ps(a.value, b.value)}; }
+        inline Packet<float> Div(const Packet<float> &a, const Packet<float> &b) { return {_mm_div_ps(a.value, b.value)}; }
+        inline Packet<float> Max(const Packet<float> &a, const Packet<float> &b) { return {_mm_max_ps(a.value, b.value)}; }
+        inline Packet<float> Abs(const Packet<float> &a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.value)}; }
+        inline Packet<float> Sqrt(const Packet<float> &a) { return {_mm_sqrt_ps(a.value)}; }
+        inline float ReduceAdd(const Packet<float> &p)
+        {
+            const __m128 pair = _mm_add_ps(p.value, _mm_movehl_ps(p.value, p.value));
+            return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+        }
+        inline float ReduceMax(const Packet<float> &p)
+        {
+            const __m128 pair = _mm_max_ps(p.value, _mm_movehl_ps(p.value, p.value));
+            return _mm_cvtss_f32(_mm_max_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+        }
+#pragma endregion
+#endif
+
+#pragma region "Precision conversion"
+        /// @brief Element types a packet converts between while it is loaded or stored:
+        /// a Packet<_From> covers Packet<_From>::Size elements of either type
+        template <typename _From, typename _To>
+        concept convertible = std::same_as<_From, _To> ||
+                              (std::same_as<_From, float> && std::same_as<_To, double>) ||
+                              (std::same_as<_From, double> && std::same_as<_To, float>);
+
+        /// @brief Packet<_To>::Size elements of a narrower type, widened while loading
+        template <typename _To, typename _From>
+        inline Packet<_To> LoadAs(const _From *ptr) { return {static_cast<_To>(*ptr)}; }
+        /// @brief Packet<_From>::Size elements rounded or widened to the destination type while storing
+        template <typename _To, typename _From>
+        inline void StoreAs(_To *ptr, const Packet<_From> &p) { *ptr = static_cast<_To>(p.value); }
+        /// @brief First Packet<double>::Size lanes of a float packet in double
+        template <typename _Ty, typename _To = double>
+        inline Packet<_To> WidenLow(const Packet<_Ty> &p) { return {static_cast<_To>(p.value)}; }
+        /// @brief Lanes from Packet<double>::Size on, only when a float packet is twice as wide
+        template <typename _Ty, typename _To = double>
+        inline Packet<_To> WidenHigh(const Packet<_Ty> &p) { return {static_cast<_To>(p.value)}; }
+#pragma endregion
+
+#if defined(LINERALGEBRA_SIMD_AVX)
+#pragma region "AVX precision conversion"
+        template <>
+        inline Packet<double> LoadAs<double, float>(const float *ptr) { return {_mm256_cvtps_pd(_mm_loadu_ps(ptr))}; }
+        inline void StoreAs(float *ptr, const Packet<double> &p) { _mm_storeu_ps(ptr, _mm256_cvtpd_ps(p.value)); }
+        inline Packet<double> WidenLow(const Packet<float> &p) { return {_mm256_cvtps_pd(_mm256_castps256_ps128(p.value))}; }
+        inline Packet<double> WidenHigh(const Packet<float> &p) { return {_mm256_cvtps_pd(_mm256_extractf128_ps(p.value, 1))}; }
+        inline void StoreAs(double *ptr, const Packet<float> &p)
+        {
+            _mm256_storeu_pd(ptr, WidenLow(p).value);
+            _mm256_storeu_pd(ptr + 4, WidenHigh(p).value);
+        }
+#pragma endregion
+#elif defined(LINERALGEBRA_SIMD_SSE2)
+#pragma region "SSE2 precision conversion"
+        template <>
+        inline Packet<double> LoadAs<double, float>(const float *ptr)
+        {
+            return {_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(ptr))))};
+        }
+        inline void StoreAs(float *ptr, const Packet<double> &p)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(ptr), _mm_castps_si128(_mm_cvtpd_ps(p.value)));
+        }
+        inline Packet<double> WidenLow(const Packet<float> &p) { return {_mm_cvtps_pd(p.value)}; }
+        inline Packet<double> WidenHigh(const Packet<float> &p) { return {_mm_cvtps_pd(_mm_movehl_ps(p.value, p.value))}; }
+        inline void StoreAs(double *ptr, const Packet<float> &p)
+        {
+            _mm_storeu_pd(ptr, WidenLow(p).value);
+            _mm_storeu_pd(ptr + 2, WidenHigh(p).value);
+        }
+#pragma endregion
+#endif
+    }
+}
@@ -0,0 +1,422 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include "Matrix.hpp"
+#include "SymMatrix.hpp"
+
+namespace LinerAlgebra
+{
+    /// @brief One (row, col, value) entry for sparse assembly, duplicates are summed
+    template <typename _Ty>
+    struct Triplet
+    {
+        size_t row;
+        size_t col;
+        _Ty value;
+    };
+
+    template <typename _Ty, StorageOrder _Order>
+    class SparseMatrix;
+
+    namespace kernel
+    {
+#pragma region "Sparse kernels"
+        /// @brief Rows [begin, end) of y = alpha * A * X + beta * y with A in CSR, X and y row-major with k columns
+        template <typename _Ty>
+        void CsrTimesDense(size_t begin, size_t end, size_t k, const size_t *outer, const size_t *inner, const _Ty *values,
+                           _Ty alpha, const _Ty *x, _Ty beta, _Ty *y)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                _Ty *yi = y + i * k;
+                for (size_t c = 0; c < k; ++c)
+                    yi[c] = (beta == _Ty(0)) ? _Ty(0) : beta * yi[c];
+                for (size_t p = outer[i]; p < outer[i + 1]; ++p)
+                {
+                    const _Ty a = alpha * values[p];
+                    const _Ty *xr = x + inner[p] * k;
+                    for (size_t c = 0; c < k; ++c)
+                        yi[c] += a * xr[c];
+                }
+            }
+        }
+
+        /// @brief y(m x k) = alpha * A * X + beta * y with A in CSC, scattering column by column
+        template <typename _Ty>
+        void CscTimesDense(size_t m, size_t n, size_t k, const size_t *outer, const size_t *inner, const _Ty *values,
+                           _Ty alpha, const _Ty *x, _Ty beta, _Ty *y)
+        {
+            for (size_t index = 0; index < m * k; ++index)
+                y[index] = (beta == _Ty(0)) ? _Ty(0) : beta * y[index];
+            for (size_t j = 0; j < n; ++j)
+            {
+                const _Ty *xr = x + j * k;
+                for (size_t p = outer[j]; p < outer[j + 1]; ++p)
+                {
+                    const _Ty a = alpha * values[p];
+                    _Ty *yi = y + inner[p] * k;
+                    for (size_t c = 0; c < k; ++c)
+                        yi[c] += a * xr[c];
+                }
+            }
+        }
+#pragma endregion
+    }
+
+    namespace lazy
+    {
+        /// @brief Sparse * dense product, a lazy node like ProductExpr
+        /// @tparam _Sparse SparseMatrix, referenced so it must outlive the expression
+        /// @tparam _RExpr Dense right operand expression
+        template <typename _Sparse, typename _RExpr>
+        class SparseProductExpr : public Expr<SparseProductExpr<_Sparse, _RExpr>>
+        {
+        public:
+            using ValueType = typename _Sparse::ValueType;
+            static constexpr size_t RowsAtCompileTime = Dynamic;
+            static constexpr size_t ColsAtCompileTime = _RExpr::ColsAtCompileTime;
+
+        private:
+            const _Sparse &lhs;
+            _RExpr rExpr;
+            mutable ResultCache<ValueType> product;
+
+            const ResultCache<ValueType> &Evaluated() const
+            {
+                if (!product.IsFilled())
+                {
+                    EvaluateTo(product.Allocate(GetRow() * GetCol()));
+                    instrument::RecordEvaluation<SparseProductExpr>(product.size());
+                    instrument::RecordTemporary<SparseProductExpr>();
+                }
+                return product;
+            }
+
+        public:
+            using BaseType = Expr<SparseProductExpr<_Sparse, _RExpr>>;
+            using BaseType::operator[];
+            using BaseType::Col;
+            using BaseType::Row;
+
+            explicit SparseProductExpr(const _Sparse &lhs, const _RExpr &rExpr) : lhs(lhs), rExpr(rExpr) {}
+            size_t GetRow() const { return lhs.Row(); }
+            size_t GetCol() const { return Extent<ColsAtCompileTime>(rExpr.Col()); }
+            constexpr static bool IsInStack() { return false; }
+            static constexpr bool IsElementwise = false;
+            static constexpr bool HoldsCache = true;
+            static constexpr size_t Cost = 0;
+            void Prepare() const { Evaluated(); }
+            auto At(size_t index) const { return Evaluated()[index]; }
+            template <typename _Ty>
+                requires std::same_as<_Ty, ValueType>
+            simd::Packet<_Ty> Packet(size_t index) const
+            {
+                return simd::Load(Evaluated().data() + index);
+            }
+            template <typename _Ty>
+            void EvaluateTo(_Ty *dst) const
+            {
+                EvaluateTo(dst, ValueType(1), ValueType(0));
+            }
+            /// @brief dst = alpha * A * X + beta * dst, CSR rows are split over the thread pool when the work is large
+            void EvaluateTo(ValueType *dst, ValueType alpha, ValueType beta) const
+            {
+                memory::ArenaScope scope;
+                ScratchBuffer<ValueType> buffer;
+                const ValueType *x = Materialize(rExpr, buffer);
+                const size_t k = GetCol();
+                if constexpr (_Sparse::Order == StorageOrder::RowMajor)
+                {
+                    auto rows = [&](size_t begin, size_t end)
+                    {
+                        kernel::CsrTimesDense(begin, end, k, lhs.OuterIndex(), lhs.InnerIndex(), lhs.Values(), alpha, x, beta, dst);
+                    };
+                    if (lhs.NonZeros() * k < parallel::Threshold())
+                        rows(0, lhs.Row());
+                    else
+                        parallel::ParallelRanges(lhs.Row(), 1, rows);
+                }
+                else
+                    kernel::CscTimesDense(lhs.Row(), lhs.Col(), k, lhs.OuterIndex(), lhs.InnerIndex(), lhs.Values(), alpha, x, beta, dst);
+            }
+        };
+    }
+
+    /// @brief Compressed sparse matrix, always sized at runtime. Indices inside each row (CSR) or column (CSC) are sorted and unique.
+    /// @tparam _Order RowMajor for CSR, ColMajor for CSC
+    template <typename _Ty = double, StorageOrder _Order = StorageOrder::RowMajor>
+    class SparseMatrix
+    {
+    public:
+        using ValueType = _Ty;
+        static constexpr StorageOrder Order = _Order;
+        static constexpr StorageOrder OtherOrder = _Order == StorageOrder::RowMajor ? StorageOrder::ColMajor : StorageOrder::RowMajor;
+        static constexpr size_t RowsAtCompileTime = Dynamic;
+        static constexpr size_t ColsAtCompileTime = Dynamic;
+
+    private:
+        template <typename, StorageOrder>
+        friend class SparseMatrix;
+
+        size_t row = 0;
+        size_t col = 0;
+        std::vector<size_t> outerIndex{0}; // start of every row (CSR) or column (CSC), plus the end
+        std::vector<size_t> innerIndex;    // column (CSR) or row (CSC) of every stored value
+        std::vector<_Ty> values;
+
+        size_t Outer(size_t r, size_t c) const { return _Order == StorageOrder::RowMajor ? r : c; }
+        size_t Inner(size_t r, size_t c) const { return _Order == StorageOrder::RowMajor ? c : r; }
+
+    public:
+        SparseMatrix() = default;
+        /// @brief All-zero matrix
+        SparseMatrix(size_t row, size_t col) : row(row), col(col), outerIndex(OuterSize() + 1, 0) {}
+
+        /// @brief Assemble from triplets in O(nnz + row + col), duplicate entries are summed
+        static SparseMatrix FromTriplets(size_t row, size_t col, const std::vector<Triplet<_Ty>> &triplets);
+
+        size_t Row() const noexcept { return row; }
+        size_t Col() const noexcept { return col; }
+        size_t NonZeros() const noexcept { return values.size(); }
+        size_t OuterSize() const noexcept { return Outer(row, col); }
+        const size_t *OuterIndex() const noexcept { return outerIndex.data(); }
+        const size_t *InnerIndex() const noexcept { return innerIndex.data(); }
+        const _Ty *Values() const noexcept { return values.data(); }
+        _Ty *Values() noexcept { return values.data(); }
+
+        /// @brief Stored value or zero, binary search inside the row (CSR) or column (CSC)
+        _Ty operator()(size_t r, size_t c) const
+        {
+            const size_t outer = Outer(r, c);
+            const auto begin = innerIndex.begin() + outerIndex[outer];
+            const auto end = innerIndex.begin() + outerIndex[outer + 1];
+            const auto it = std::lower_bound(begin, end, Inner(r, c));
+            return (it != end && *it == Inner(r, c)) ? values[it - innerIndex.begin()] : _Ty(0);
+        }
+
+#pragma region "Operator overloading"
+        template <lazy::expression _OTy>
+        auto operator*(const _OTy &other) const
+        {
+            lazy::CheckProductSize(*this, other);
+            return lazy::SparseProductExpr<SparseMatrix, _OTy>(*this, other);
+        }
+        template <lazy::matrix _OTy>
+        auto operator*(const _OTy &other) const
+        {
+            lazy::CheckProductSize(*this, other);
+            using ExprT = lazy::ExprStart<_OTy>;
+            return lazy::SparseProductExpr<SparseMatrix, ExprT>(*this, ExprT(other));
+        }
+        template <lazy::arithmetic _OTy>
+        SparseMatrix operator*(const _OTy &other) const
+        {
+            SparseMatrix res = *this;
+            for (auto &value : res.values)
+                value *= other;
+            return res;
+        }
+#pragma endregion
+
+        /// @brief Aᵀ without moving any value: the CSR arrays of A are the CSC arrays of Aᵀ and vice versa
+        SparseMatrix<_Ty, OtherOrder> Transpose() const &;
+        SparseMatrix<_Ty, OtherOrder> Transpose() &&;
+        /// @brief The same matrix in the other compressed order
+        SparseMatrix<_Ty, OtherOrder> Convert() const;
+        DMatrix<_Ty> Dense() const;
+    };
+
+    template <typename _Ty = double>
+    using CsrMatrix = SparseMatrix<_Ty, StorageOrder::RowMajor>;
+    template <typename _Ty = double>
+    using CscMatrix = SparseMatrix<_Ty, StorageOrder::ColMajor>;
+
+#pragma region "SparseMatrix function"
+    template <typename _Ty, StorageOrder _Order>
+    inline SparseMatrix<_Ty, _Order> SparseMatrix<_Ty, _Order>::FromTriplets(size_t row, size_t col, const std::vector<Triplet<_Ty>> &triplets)
+    {
+        SparseMatrix res(row, col);
+        const size_t outerSize = res.OuterSize();
+        const size_t innerSize = res.Inner(row, col);
+        for (auto &triplet : triplets)
+            if (triplet.row >= row || triplet.col >= col)
+                throw SizeExcept();
+
+        // bucket by inner index, then stably by outer index, so every segment ends up sorted
+        memory::ArenaScope scope;
+        lazy::ScratchBuffer<size_t> innerStart(innerSize + 1, 0);
+        for (auto &triplet : triplets)
+            ++innerStart[res.Inner(triplet.row, triplet.col) + 1];
+        for (size_t i = 0; i < innerSize; ++i)
+            innerStart[i + 1] += innerStart[i];
+        lazy::ScratchBuffer<size_t> byInner(triplets.size());
+        for (size_t t = 0; t < triplets.size(); ++t)
+            byInner[innerStart[res.Inner(triplets[t].row, triplets[t].col)]++] = t;
+
+        std::vector<size_t> &outer = res.outerIndex;
+        for (auto &triplet : triplets)
+            ++outer[res.Outer(triplet.row, triplet.col) + 1];
+        for (size_t i = 0; i < outerSize; ++i)
+            outer[i + 1] += outer[i];
+        lazy::ScratchBuffer<size_t> next(outer.begin(), outer.end() - 1);
+        res.innerIndex.resize(triplets.size());
+        res.values.resize(triplets.size());
+        for (size_t t : byInner)
+        {
+            const size_t position = next[res.Outer(triplets[t].row, triplets[t].col)]++;
+            res.innerIndex[position] = res.Inner(triplets[t].row, triplets[t].col);
+            res.values[position] = triplets[t].value;
+        }
+
+        // sum duplicates, compacting in place
+        size_t write = 0;
+        for (size_t o = 0, read = 0; o < outerSize; ++o)
+        {
+            const size_t end = outer[o + 1];
+            outer[o] = write;
+            for (; read < end; ++read)
+            {
+                if (write > outer[o] && res.innerIndex[write - 1] == res.innerIndex[read])
+                    res.values[write - 1] += res.values[read];
+                else
+                {
+                    res.innerIndex[write] = res.innerIndex[read];
+                    res.values[write++] = res.values[read];
+                }
+            }
+        }
+        outer[outerSize] = write;
+        res.innerIndex.resize(write);
+        res.values.resize(write);
+        return res;
+    }
+
+    template <typename _Ty, StorageOrder _Order>
+    inline SparseMatrix<_Ty, SparseMatrix<_Ty, _Order>::OtherOrder> SparseMatrix<_Ty, _Order>::Transpose() const &
+    {
+        return SparseMatrix(*this).Transpose();
+    }
+
+    template <typename _Ty, StorageOrder _Order>
+    inline SparseMatrix<_Ty, SparseMatrix<_Ty, _Order>::OtherOrder> SparseMatrix<_Ty, _Order>::Transpose() &&
+    {
+        SparseMatrix<_Ty, OtherOrder> res;
+        res.row = col;
+        res.col = row;
+        res.outerIndex = std::move(outerIndex);
+        res.innerIndex = std::move(innerIndex);
+        res.values = std::move(values);
+        *this = SparseMatrix(row, col);
+        return res;
+    }
+
+    template <typename _Ty, StorageOrder _Order>
+    inline SparseMatrix<_Ty, SparseMatrix<_Ty, _Order>::OtherOrder> SparseMatrix<_Ty, _Order>::Convert() const
+    {
+        SparseMatrix<_Ty, OtherOrder> res(row, col);
+        const size_t outerSize = OuterSize();
+        const size_t innerSize = res.OuterSize();
+        std::vector<size_t> &outer = res.outerIndex;
+        for (size_t p = 0; p < NonZeros(); ++p)
+            ++outer[innerIndex[p] + 1];
+        for (size_t i = 0; i < innerSize; ++i)
+            outer[i + 1] += outer[i];
+        memory::ArenaScope scope;
+        lazy::ScratchBuffer<size_t> next(outer.begin(), outer.end() - 1);
+        res.innerIndex.resize(NonZeros());
+        res.values.resize(NonZeros());
+        // walking the outer index in order keeps every new segment sorted
+        for (size_t o = 0; o < outerSize; ++o)
+        {
+            for (size_t p = outerIndex[o]; p < outerIndex[o + 1]; ++p)
+            {
+                const size_t position = next[innerIndex[p]]++;
+                res.innerIndex[position] = o;
+                res.values[position] = values[p];
+            }
+        }
+        return res;
+    }
+
+    template <typename _Ty, StorageOrder _Order>
+    inline DMatrix<_Ty> SparseMatrix<_Ty, _Order>::Dense() const
+    {
+        DMatrix<_Ty> res(row, col);
+        for (size_t o = 0; o < OuterSize(); ++o)
+        {
+            for (size_t p = outerIndex[o]; p < outerIndex[o + 1]; ++p)
+            {
+                if constexpr (_Order == StorageOrder::RowMajor)
+                    res(o, innerIndex[p]) = values[p];
+                else
+                    res(innerIndex[p], o) = values[p];
+            }
+        }
+        return res;
+    }
+#pragma endregion
+
+    template <lazy::arithmetic _Num, typename _Ty, StorageOrder _Order>
+    SparseMatrix<_Ty, _Order> operator*(const _Num &num, const SparseMatrix<_Ty, _Order> &mat)
+    {
+        return mat * num;
+    }
+
+#pragma region "Normal equations"
+    /// @brief Normal matrix AᵀA as a packed symmetric matrix.
+    /// Output row i gathers column i of A against the rows it touches, so threads own disjoint output rows.
+    template <typename _Ty, StorageOrder _Order>
+    DSymMatrix<_Ty> AtA(const SparseMatrix<_Ty, _Order> &a)
+    {
+        const size_t n = a.Col();
+        DSymMatrix<_Ty> res(n);
+        auto build = [&](const CsrMatrix<_Ty> &csr, const CscMatrix<_Ty> &csc)
+        {
+            size_t work = 0;
+            for (size_t r = 0; r < csr.Row(); ++r)
+            {
+                const size_t length = csr.OuterIndex()[r + 1] - csr.OuterIndex()[r];
+                work += length * length;
+            }
+            auto rows = [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    // element (i, j) of the packed row i sits at base + j
+                    _Ty *base = res.Packed() + kernel::PackedIndex(n, i, i) - i;
+                    for (size_t p = csc.OuterIndex()[i]; p < csc.OuterIndex()[i + 1]; ++p)
+                    {
+                        const size_t r = csc.InnerIndex()[p];
+                        const _Ty ari = csc.Values()[p];
+                        const size_t *first = csr.InnerIndex() + csr.OuterIndex()[r];
+                        const size_t *last = csr.InnerIndex() + csr.OuterIndex()[r + 1];
+                        for (const size_t *q = std::lower_bound(first, last, i); q != last; ++q)
+                            base[*q] += ari * csr.Values()[q - csr.InnerIndex()];
+                    }
+                }
+            };
+            if (work < parallel::Threshold())
+                rows(0, n);
+            else
+                parallel::ParallelRanges(n, 1, rows);
+        };
+        if constexpr (_Order == StorageOrder::RowMajor)
+            build(a, a.Convert());
+        else
+            build(a.Convert(), a);
+        return res;
+    }
+
+    /// @brief Normal right-hand side Aᵀb for a dense b with A.Row() rows, as CSR rows of Aᵀ split over the thread pool
+    template <typename _Ty, StorageOrder _Order, typename _Rhs>
+    DMatrix<_Ty> Atb(const SparseMatrix<_Ty, _Order> &a, const _Rhs &b)
+    {
+        if constexpr (_Order == StorageOrder::RowMajor)
+            return a.Convert().Transpose() * b;
+        else
+            return a.Transpose() * b;
+    }
+#pragma endregion
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility>
+#include <initializer_list>
+#include "Matrix.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+        /// @brief Elements of the packed upper triangle of a n x n matrix
+        constexpr size_t PackedSize(size_t n)
+        {
+            return n * (n + 1) / 2;
+        }
+
+        /// @brief Position of (row, col), row <= col, in a packed upper triangle stored row by row
+        constexpr size_t PackedIndex(size_t n, size_t row, size_t col)
+        {
+            return row * (2 * n - row - 1) / 2 + col;
+        }
+
+#pragma region "Propagation kernel"
+        /// @brief out = F * P * Fᵀ + Q with P, Q and out packed. F * P is a full product,
+        /// F * P * Fᵀ only computes the upper half, so the result is exactly symmetric.
+        /// @param f n x n row-major
+        /// @param q Packed Q, nullptr for none
+        /// @param out May alias p or q
+        /// @param work At least 2 * n * n elements
+        template <size_t _N, typename _Ty>
+        void SymPropagateKernel(size_t n, const _Ty *f, const _Ty *p, const _Ty *q, _Ty *out, _Ty *work)
+        {
+            _Ty *pd = work;
+            _Ty *fp = work + n * n;
+            for (size_t i = 0, index = 0; i < n; ++i)
+                for (size_t j = i; j < n; ++j, ++index)
+                    pd[i * n + j] = pd[j * n + i] = p[index];
+            if constexpr (Unrollable(_N, _N))
+            {
+                FixedProduct<_N, _N, _N>(f, pd, fp);
+                size_t index = 0;
+                StaticFor<_N>(n, [&](size_t i)
+                              {
+                    for (size_t j = i; j < n; ++j, ++index)
+                    {
+                        _Ty sum = q ? q[index] : _Ty(0);
+                        for (size_t k = 0; k < n; ++k)
+                            sum += fp[i * n + k] * f[j * n + k];
+                        out[index] = sum;
+                    } });
+            }
+            else
+            {
+                Gemm<_Ty>(n, n, n, _Ty(1), {f, n, 1}, {pd, n, 1}, _Ty(0), {fp, n, 1});
+                // upper triangle of Q + (F * P) * Fᵀ over pd
+                if (q)
+                    for (size_t i = 0, index = 0; i < n; index += n - i, ++i)
+                        std::copy_n(q + index, n - i, pd + i * n + i);
+                GemmUpper<_Ty>(n, n, _Ty(1), {fp, n, 1}, {f, 1, n}, q ? _Ty(1) : _Ty(0), {pd, n, 1});
+                for (size_t i = 0, index = 0; i < n; index += n - i, ++i)
+                    std::copy_n(pd + i * n + i, n - i, out + index);
+            }
+        }
+
+        /// @brief SymPropagateKernel with its scratch on the stack for unrollable sizes and in the thread's arena otherwise
+        template <size_t _N, typename _Ty>
+        void SymPropagate(size_t n, const _Ty *f, const _Ty *p, const _Ty *q, _Ty *out)
+        {
+            if constexpr (Unrollable(_N, _N))
+            {
+                std::array<_Ty, 2 * _N * _N> work{};
+                SymPropagateKernel<_N>(_N, f, p, q, out, work.data());
+            }
+            else
+            {
+                memory::ArenaScope scope;
+                lazy::ScratchBuffer<_Ty> work(2 * n * n);
+                SymPropagateKernel<_N>(n, f, p, q, out, work.data());
+            }
+        }
+#pragma endregion
+    }
+
+    /// @brief Symmetric matrix keeping only its upper triangle, packed row by row.
+    /// Reads through lazy expressions like any matrix; assignment from an expression takes its upper triangle.
+    /// @tparam _N Order, Dynamic for a runtime size
+    template <size_t _N, typename _Ty = double, typename _Alloc = std::allocator<_Ty>>
+    class SymMatrix
+    {
+    public:
+        using ValueType = _Ty;
+        using AllocatorType = _Alloc;
+        using StorageType = std::conditional_t<isLittle(_N, _N), std::array<_Ty, kernel::PackedSize(_N)>, std::vector<_Ty, _Alloc>>;
+        static constexpr size_t RowsAtCompileTime = _N;
+        static constexpr size_t ColsAtCompileTime = _N;
+
+    private:
+        StorageType elements{};
+        size_t order = _N;
+
+        template <typename _Src>
+        constexpr SymMatrix &Assign(const _Src &src)
+        {
+            lazy::CheckSameSize(*this, src);
+            const size_t n = Row();
+            for (size_t i = 0, index = 0; i < n; ++i)
+                for (size_t j = i; j < n; ++j, ++index)
+                    elements[index] = src[i * n + j];
+            return *this;
+        }
+        /// @brief Square shape of a source, resizing a dynamic target to it
+        template <typename _Src>
+        constexpr void Fit(const _Src &src)
+        {
+            static_assert(lazy::DimMatch(_Src::RowsAtCompileTime, _Src::ColsAtCompileTime), "不是方阵!");
+            if (src.Row() != src.Col())
+                throw SizeExcept();
+            if constexpr (IsDynamic())
+                Resize(src.Row());
+        }
+
+    public:
+        constexpr SymMatrix()
+        {
+            if constexpr (!IsDynamic() && !IsInStack())
+                elements.resize(kernel::PackedSize(_N));
+        }
+        explicit SymMatrix(size_t n) : SymMatrix() { Resize(n); }
+        /// @brief Full square list, only the upper triangle is read
+        constexpr SymMatrix(std::initializer_list<std::initializer_list<_Ty>> list);
+        /// @brief Upper triangle of a square expression, or explicitly of another matrix
+        template <typename _Src>
+            requires lazy::expression<_Src> || lazy::leaf<_Src>
+        constexpr explicit(!lazy::expression<_Src>) SymMatrix(const _Src &src) : SymMatrix()
+        {
+            *this = src;
+        }
+
+        constexpr static bool IsDynamic() { return _N == 0; }
+        constexpr static bool IsInStack() { return isLittle(_N, _N); }
+        constexpr size_t Row() const noexcept { return lazy::Extent<_N>(order); }
+        constexpr size_t Col() const noexcept { return lazy::Extent<_N>(order); }
+        /// @brief Number of stored elements, n * (n + 1) / 2
+        constexpr size_t Size() const noexcept { return elements.size(); }
+        constexpr _Ty *Packed() noexcept { return elements.data(); }
+        constexpr const _Ty *Packed() const noexcept { return elements.data(); }
+
+#pragma region "Element access"
+        /// @brief (row, col) and (col, row) are the same element
+        constexpr _Ty &operator()(size_t row, size_t col)
+        {
+            if (row > col)
+                std::swap(row, col);
+            return elements[kernel::PackedIndex(Row(), row, col)];
+        }
+        constexpr const _Ty operator()(size_t row, size_t col) const
+        {
+            if (row > col)
+                std::swap(row, col);
+            return elements[kernel::PackedIndex(Row(), row, col)];
+        }
+        /// @brief Element at a row-major index of the full matrix, how expressions read this storage
+        constexpr const _Ty operator[](size_t index) const { return (*this)(index / Col(), index % Col()); }
+#pragma endregion
+
+#pragma region "Operator overloading"
+        template <typename _OTy>
+        constexpr auto operator+(const _OTy &other) const { return lazy::ExprStart<SymMatrix>(*this) + other; }
+        template <typename _OTy>
+        constexpr auto operator-(const _OTy &other) const { return lazy::ExprStart<SymMatrix>(*this) - other; }
+        template <typename _OTy>
+        constexpr auto operator*(const _OTy &other) const { return lazy::ExprStart<SymMatrix>(*this) * other; }
+        template <lazy::arithmetic _OTy>
+        constexpr auto operator/(const _OTy &other) const { return lazy::ExprStart<SymMatrix>(*this) / other; }
+#pragma endregion
+
+#pragma region "Assignment"
+        template <typename _Src>
+            requires lazy::expression<_Src> || (lazy::leaf<_Src> && !std::is_same_v<_Src, SymMatrix>)
+        constexpr SymMatrix &operator=(const _Src &src)
+        {
+            Fit(src);
+            return Assign(src);
+        }
+        /// @brief Packed elementwise update, the lower triangle is never touched
+        constexpr SymMatrix &operator+=(const SymMatrix &other)
+        {
+            lazy::CheckSameSize(*this, other);
+            for (size_t index = 0; index < Size(); ++index)
+                elements[index] += other.elements[index];
+            return *this;
+        }
+        constexpr SymMatrix &operator-=(const SymMatrix &other)
+        {
+            lazy::CheckSameSize(*this, other);
+            for (size_t index = 0; index < Size(); ++index)
+                elements[index] -= other.elements[index];
+            return *this;
+        }
+        template <lazy::arithmetic _OTy>
+        constexpr SymMatrix &operator*=(const _OTy &other)
+        {
+            for (auto &element : elements)
+                element *= other;
+            return *this;
+        }
+        template <lazy::arithmetic _OTy>
+        constexpr SymMatrix &operator/=(const _OTy &other)
+        {
+            for (auto &element : elements)
+                element /= other;
+            return *this;
+        }
+#pragma endregion
+
+        /// @brief P = F * P * Fᵀ + Q in place, with half of the second product and exact symmetry
+        /// @param f Square matrix or expression of the same order
+        template <typename _FMat>
+        SymMatrix &Propagate(const _FMat &f, const SymMatrix &q)
+        {
+            lazy::CheckSameSize(*this, q);
+            return PropagatePacked(f, q.Packed());
+        }
+        /// @brief P = F * P * Fᵀ in place
+        template <typename _FMat>
+        SymMatrix &Propagate(const _FMat &f) { return PropagatePacked(f, nullptr); }
+
+        constexpr SymMatrix &Resize(size_t n);
+        /// @brief Both triangles as a dense matrix
+        constexpr Matrix<_N, _N, _Ty, _Alloc> Dense() const;
+
+        constexpr static SymMatrix Identity();
+        static SymMatrix Identity(size_t n);
+
+    private:
+        template <typename _FMat>
+        SymMatrix &PropagatePacked(const _FMat &f, const _Ty *q)
+        {
+            lazy::CheckSameSize(*this, f);
+            if constexpr (lazy::contiguous<_FMat, _Ty>)
+                kernel::SymPropagate<_N>(Row(), f.Data(), Packed(), q, Packed());
+            else
+            {
+                const auto dense = static_cast<Matrix<_N, _N, _Ty, std::allocator<_Ty>>>(f);
+                kernel::SymPropagate<_N>(Row(), dense.Data(), Packed(), q, Packed());
+            }
+            return *this;
+        }
+    };
+
+    template <lazy::arithmetic _Num, size_t _N, typename _Ty, typename _Alloc>
+    constexpr auto operator*(const _Num &num, const SymMatrix<_N, _Ty, _Alloc> &mat)
+    {
+        return mat * num;
+    }
+
+    template <typename _Ty = double, typename _Alloc = std::allocator<_Ty>>
+    using DSymMatrix = SymMatrix<Dynamic, _Ty, _Alloc>;
+
+    template <size_t _N, typename _Ty, typename _Alloc>
+    inline constexpr SymMatrix<_N, _Ty, _Alloc>::SymMatrix(std::initializer_list<std::initializer_list<_Ty>> list) : SymMatrix()
+    {
+        if constexpr (IsDynamic())
+            Resize(list.size());
+        else if (list.size() != _N)
+            throw SizeExcept();
+        size_t i = 0, index = 0;
+        for (auto &row : list)
+        {
+            if (row.size() != Row())
+                throw SizeExcept();
+            for (size_t j = i; j < Row(); ++j, ++index)
+                elements[index] = *(row.begin() + j);
+            ++i;
+        }
+    }
+
+    template <size_t _N, typename _Ty, typename _Alloc>
+    inline constexpr SymMatrix<_N, _Ty, _Alloc> &SymMatrix<_N, _Ty, _Alloc>::Resize(size_t n)
+    {
+        if constexpr (IsDynamic())
+        {
+            elements.resize(kernel::PackedSize(n));
+            order = n;
+        }
+        else if (n != _N)
+            throw SizeExcept();
+        return *this;
+    }
+
+    template <size_t _N, typename _Ty, typename _Alloc>
+    inline constexpr Matrix<_N, _N, _Ty, _Alloc> SymMatrix<_N, _Ty, _Alloc>::Dense() const
+    {
+        const size_t n = Row();
+        Matrix<_N, _N, _Ty, _Alloc> res(n, n);
+        for (size_t i = 0, index = 0; i < n; ++i)
+            for (size_t j = i; j < n; ++j, ++index)
+                res(i, j) = res(j, i) = elements[index];
+        return res;
+    }
+
+    template <size_t _N, typename _Ty, typename _Alloc>
+    inline constexpr SymMatrix<_N, _Ty, _Alloc> SymMatrix<_N, _Ty, _Alloc>::Identity()
+    {
+        if constexpr (!IsDynamic())
+        {
+            SymMatrix res;
+            for (size_t i = 0; i < _N; ++i)
+                res(i, i) = _Ty(1);
+            return res;
+        }
+        else
+            return SymMatrix();
+    }
+
+    template <size_t _N, typename _Ty, typename _Alloc>
+    inline SymMatrix<_N, _Ty, _Alloc> SymMatrix<_N, _Ty, _Alloc>::Identity(size_t n)
+    {
+        SymMatrix res;
+        res.Resize(n);
+        for (size_t i = 0; i < n; ++i)
+            res(i, i) = _Ty(1);
+        return res;
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include "Gemm.hpp"
+
+namespace LinerAlgebra
+{
+    namespace kernel
+    {
+        /// @brief Rows of the diagonal block solved without GEMM, the rest of the panel is updated with GEMM
+        constexpr size_t TrsmBlock = 64;
+        /// @brief Independent packets of rows in flight in a right-hand solve X * Lᵀ = B
+        constexpr size_t TrsmRowPackets = 4;
+
+#pragma region "Unblocked triangular solve"
+        /// @brief Solve L * X = B in place, L is n x n lower triangular, B is n x m
+        template <typename _Ty>
+        void TrsmLowerUnblocked(size_t n, size_t m, StridedRef<const _Ty> l, StridedRef<_Ty> b, bool unitDiag)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t k = 0; k < i; ++k)
+                {
+                    const _Ty lik = l(i, k);
+                    if (lik != _Ty(0))
+                        for (size_t j = 0; j < m; ++j)
+                            b(i, j) -= lik * b(k, j);
+                }
+                if (!unitDiag)
+                {
+                    const _Ty inv = _Ty(1) / l(i, i);
+                    for (size_t j = 0; j < m; ++j)
+                        b(i, j) *= inv;
+                }
+            }
+        }
+
+        /// @brief Solve U * X = B in place, U is n x n upper triangular, B is n x m
+        template <typename _Ty>
+        void TrsmUpperUnblocked(size_t n, size_t m, StridedRef<const _Ty> u, StridedRef<_Ty> b, bool unitDiag)
+        {
+            for (size_t i = n; i-- > 0;)
+            {
+                for (size_t k = i + 1; k < n; ++k)
+                {
+                    const _Ty uik = u(i, k);
+                    if (uik != _Ty(0))
+                        for (size_t j = 0; j < m; ++j)
+                            b(i, j) -= uik * b(k, j);
+                }
+                if (!unitDiag)
+                {
+                    const _Ty inv = _Ty(1) / u(i, i);
+                    for (size_t j = 0; j < m; ++j)
+                        b(i, j) *= inv;
+                }
+            }
+        }
+#pragma endregion
+
+        /// @brief Blocked forward substitution L * X = B, X overwrites B
+        /// @param l Lower triangle, the strict upper part is never read (pass Transposed() to use an upper factor)
+        template <typename _Ty>
+        void TrsmLower(size_t n, size_t m, StridedRef<const _Ty> l, StridedRef<_Ty> b, bool unitDiag = false)
+        {
+            for (size_t i0 = 0; i0 < n; i0 += TrsmBlock)
+            {
+                const size_t ib = std::min(TrsmBlock, n - i0);
+                TrsmLowerUnblocked(ib, m, l.Block(i0, i0), b.Block(i0, 0), unitDiag);
+                if (const size_t rest = n - i0 - ib; rest > 0)
+                    Gemm<_Ty>(rest, m, ib, _Ty(-1), l.Block(i0 + ib, i0), b.Block(i0, 0), _Ty(1), b.Block(i0 + ib, 0));
+            }
+        }
+
+        /// @brief Solve X * Lᵀ = B in place for the m x n block B, the panel solve of a right-looking Cholesky.
+        /// Rows of B are solved TrsmRowPackets packets at a time, row r of a group in lane r, so every
+        /// substitution step is one broadcast of l(q, p) and a packet multiply-add and no column is walked.
+        /// @param l Lower triangle, the strict upper part is never read
+        template <typename _Ty>
+        void TrsmLowerTransposedRight(size_t m, size_t n, StridedRef<const _Ty> l, StridedRef<_Ty> b, bool unitDiag = false)
+        {
+            using Packet = simd::Packet<_Ty>;
+            constexpr size_t width = Packet::Size, group = width * TrsmRowPackets;
+            memory::ArenaScope scope;
+            // x(q, r) is element q of row r of the group, unused lanes of the last group stay zero
+            std::vector<_Ty, memory::ArenaAllocator<_Ty>> x(n * group), inv(n);
+            for (size_t p = 0; p < n; ++p)
+                inv[p] = unitDiag ? _Ty(1) : _Ty(1) / l(p, p);
+            for (size_t i0 = 0; i0 < m; i0 += group)
+            {
+                const size_t rows = std::min(group, m - i0);
+                for (size_t q = 0; q < n; ++q)
+                    for (size_t r = 0; r < group; ++r)
+                        x[q * group + r] = r < rows ? b(i0 + r, q) : _Ty(0);
+                for (size_t q = 0; q < n; ++q)
+                {
+                    _Ty *xq = x.data() + q * group;
+                    Packet sums[TrsmRowPackets];
+                    for (size_t g = 0; g < TrsmRowPackets; ++g)
+                        sums[g] = simd::Load(xq + g * width);
+                    for (size_t p = 0; p < q; ++p)
+                    {
+                        const Packet lqp = simd::Set1(l(q, p));
+                        const _Ty *xp = x.data() + p * group;
+                        for (size_t g = 0; g < TrsmRowPackets; ++g)
+                            sums[g] = simd::Sub(sums[g], simd::Mul(lqp, simd::Load(xp + g * width)));
+                    }
+                    const Packet scale = simd::Set1(inv[q]);
+                    for (size_t g = 0; g < TrsmRowPackets; ++g)
+                        simd::Store(xq + g * width, simd::Mul(sums[g], scale));
+                }
+                for (size_t r = 0; r < rows; ++r)
+                    for (size_t q = 0; q < n; ++q)
+                        b(i0 + r, q) = x[q * group + r];
+            }
+        }
+
+        /// @brief Blocked back substitution U * X = B, X overwrites B
+        /// @param u Upper triangle, the strict lower part is never read
+        template <typename _Ty>
+        void TrsmUpper(size_t n, size_t m, StridedRef<const _Ty> u, StridedRef<_Ty> b, bool unitDiag = false)
+        {
+            for (size_t end = n; end > 0;)
+            {
+                const size_t ib = std::min(TrsmBlock, end);
+                const size_t i0 = end - ib;
+                TrsmUpperUnblocked(ib, m, u.Block(i0, i0), b.Block(i0, 0), unitDiag);
+                if (i0 > 0)
+                    Gemm<_Ty>(i0, m, ib, _Ty(-1), u.Block(0, i0), b.Block(i0, 0), _Ty(1), b);
+                end = i0;
+            }
+        }
+    }
+}